@@ -0,0 +1,90 @@
+#ifndef BASE_CPU_H
+#define BASE_CPU_H
+
+#include "base_types.h"
+
+#if ARCH_AMD64 && !COMPILER_CL
+# include <cpuid.h>
+#endif
+
+///////////////////////////////
+// NOTE: CPU Features
+///////////////////////////////
+// NOTE: SSE2 is part of x86-64 so it's always there. Anything wider is compiled per function with
+// TARGET_AVX2 or TARGET_AVX512BW and only called after cpu_features() says the cpu (and the OS, for the ymm,
+// zmm and mask register state) supports it.
+
+#if COMPILER_CL
+# define TARGET_AVX2
+# define TARGET_AVX512BW
+#else
+# define TARGET_AVX2 __attribute__((target("avx2")))
+# define TARGET_AVX512BW __attribute__((target("avx512f,avx512bw")))
+#endif
+
+typedef enum CPUFeature{
+    CPUFeature_avx2 = (1 << 0),
+    CPUFeature_avx512bw = (1 << 1),
+} CPUFeature;
+
+#if ARCH_AMD64
+static void
+cpu_id(u32 leaf, u32 subleaf, u32* regs){
+#if COMPILER_CL
+    __cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static u64
+cpu_xgetbv(void){
+#if COMPILER_CL
+    return(_xgetbv(0));
+#else
+    u32 lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return(((u64)hi << 32) | lo);
+#endif
+}
+#endif
+
+static u32
+cpu_features_detect(void){
+    u32 result = 0;
+#if ARCH_AMD64
+    u32 regs[4];
+    cpu_id(0, 0, regs);
+    u32 max_leaf = regs[0];
+    cpu_id(1, 0, regs);
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    bool avx = (regs[2] & (1 << 28)) != 0;
+    // NOTE: XCR0 bits 1 and 2, the OS saves xmm and ymm state on context switch. Bits 5 to 7 add the
+    // opmask registers and the upper zmm state.
+    if(max_leaf >= 7 && osxsave && avx){
+        u64 xcr0 = cpu_xgetbv();
+        cpu_id(7, 0, regs);
+        if((xcr0 & 0x6) == 0x6 && (regs[1] & (1 << 5))){
+            result |= CPUFeature_avx2;
+        }
+        // NOTE: EBX bit 16 is AVX-512F, bit 30 AVX-512BW.
+        if((xcr0 & 0xE6) == 0xE6 && (regs[1] & (1 << 16)) && (regs[1] & (1u << 30))){
+            result |= CPUFeature_avx512bw;
+        }
+    }
+#endif
+    return(result);
+}
+
+// NOTE: Detected once. The check is kept apart from the detection so it inlines, every later call is a load and
+// a predictable branch.
+global u32 cpu_features_cache = u32_max;
+static u32
+cpu_features(void){
+    if(cpu_features_cache == u32_max){
+        cpu_features_cache = cpu_features_detect();
+    }
+    return(cpu_features_cache);
+}
+
+#endif
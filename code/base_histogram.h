@@ -0,0 +1,98 @@
+#ifndef BASE_HISTOGRAM_H
+#define BASE_HISTOGRAM_H
+
+#include "base_types.h"
+#include "base_math.h"
+#include "base_memory.h"
+
+///////////////////////////////
+// NOTE: Log Bucketed Histogram
+///////////////////////////////
+// NOTE: HDR style. Values below 2^HISTOGRAM_SUB_BUCKET_BITS get a bucket each, every power of two above that is
+// split into 2^HISTOGRAM_SUB_BUCKET_BITS equal buckets. A bucket is never wider than 1/16th of the values in it,
+// so any u64 is recorded to within ~6% in a fixed 8KB, with a shift and an increment. Percentiles answer with the
+// top of the bucket they land in so they never understate a latency, min and max are exact.
+//
+// usage:
+//     Histogram h;
+//     histogram_reset(&h);
+//     histogram_record(&h, elapsed);
+//     u64 p99 = histogram_percentile(&h, 0.99);
+
+#define HISTOGRAM_SUB_BUCKET_BITS 4
+#define HISTOGRAM_SUB_BUCKET_COUNT (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKET_COUNT ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKET_COUNT)
+
+typedef struct Histogram{
+    u64 count;
+    u64 total;
+    u64 min;
+    u64 max;
+    u64 buckets[HISTOGRAM_BUCKET_COUNT];
+} Histogram;
+
+static void
+histogram_reset(Histogram* h){
+    mem_set(h, 0, sizeof(*h));
+    h->min = u64_max;
+}
+
+static u32
+histogram_bucket_index(u64 value){
+    if(value < HISTOGRAM_SUB_BUCKET_COUNT){
+        return((u32)value);
+    }
+    // NOTE: The top HISTOGRAM_SUB_BUCKET_BITS + 1 bits pick the bucket, the leading one says which power of two.
+    u32 shift = highest_set_bit_u64(value) - HISTOGRAM_SUB_BUCKET_BITS;
+    u32 sub_bucket = (u32)(value >> shift) - HISTOGRAM_SUB_BUCKET_COUNT;
+    return((shift + 1) * HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket);
+}
+
+static u64
+histogram_bucket_low(u32 index){
+    if(index < HISTOGRAM_SUB_BUCKET_COUNT){
+        return(index);
+    }
+    u32 shift = index / HISTOGRAM_SUB_BUCKET_COUNT - 1;
+    u64 sub_bucket = index % HISTOGRAM_SUB_BUCKET_COUNT;
+    return((HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket) << shift);
+}
+
+// NOTE: Last value that lands in the bucket.
+static u64
+histogram_bucket_high(u32 index){
+    if(index < HISTOGRAM_SUB_BUCKET_COUNT){
+        return(index);
+    }
+    u32 shift = index / HISTOGRAM_SUB_BUCKET_COUNT - 1;
+    return(histogram_bucket_low(index) + ((1ull << shift) - 1));
+}
+
+static void
+histogram_record(Histogram* h, u64 value){
+    h->buckets[histogram_bucket_index(value)] += 1;
+    h->count += 1;
+    h->total += value;
+    h->min = MIN(h->min, value);
+    h->max = MAX(h->max, value);
+}
+
+// NOTE: fraction in [0, 1]. 0 for an empty histogram, capped at the exact max.
+static u64
+histogram_percentile(Histogram* h, f64 fraction){
+    if(h->count == 0){
+        return(0);
+    }
+    u64 rank = (u64)(fraction * (f64)h->count);
+    rank = CLAMP(1, rank, h->count);
+    u64 seen = 0;
+    for(u32 i=0; i < HISTOGRAM_BUCKET_COUNT; ++i){
+        seen += h->buckets[i];
+        if(seen >= rank){
+            return(MIN(histogram_bucket_high(i), h->max));
+        }
+    }
+    return(h->max);
+}
+
+#endif
@@ -2,11 +2,16 @@
 #define BASE_INCLUDE_H
 
 #include "base_types.h"
+#include "base_cpu.h"
 #include "base_math.h"
 #include "base_vector.h"
 #include "base_matrix.h"
 #include "base_memory.h"
 #include "base_linkedlist.h"
 #include "base_string.h"
+#include "base_writer.h"
+#include "base_timer.h"
+#include "base_profile.h"
+#include "base_histogram.h"
 
 #endif
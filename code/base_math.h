@@ -17,6 +17,42 @@
 #define AlignUpPow2(x,p) (((x) + (p) - 1)&~((p) - 1))
 #define AlignDownPow2(x,p) ((x)&~((p) - 1))
 
+// NOTE: x must not be 0.
+static u32
+count_trailing_zeros_u32(u32 x){
+#if COMPILER_CL
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return((u32)index);
+#else
+    return((u32)__builtin_ctz(x));
+#endif
+}
+
+// NOTE: x must not be 0.
+static u32
+count_trailing_zeros_u64(u64 x){
+#if COMPILER_CL
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return((u32)index);
+#else
+    return((u32)__builtin_ctzll(x));
+#endif
+}
+
+// NOTE: Index of the highest set bit, x must not be 0.
+static u32
+highest_set_bit_u64(u64 x){
+#if COMPILER_CL
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return((u32)index);
+#else
+    return(63 - (u32)__builtin_clzll(x));
+#endif
+}
+
 global f32 PI_f32 = 3.14159265359f;
 global f64 PI_f64 = 3.14159265359;
 global f32 RAD_f32 = 0.0174533f;
@@ -2,67 +2,240 @@
 #define BASE_MEMORY_H
 
 #include <stdlib.h>
+#include <string.h>
 #include "base_types.h"
 #include "base_math.h"
 
-// UNTESTED:
+///////////////////////////////
+// NOTE: Memory Primitives
+///////////////////////////////
+// NOTE: Thin wrappers over libc. Compilers inline the small constant sizes and libc picks the best vector
+// routine for the cpu at load time, hand written SSE2/AVX2 versions measured slower at every size (db_microbench).
+// mem_copy has memcpy semantics, the ranges must not overlap (use memmove for that).
+
 static void*
 mem_set(void *base, int source, size_t size) {
-    u8* base_ref = (u8*)base;
-    while(size--) *base_ref++ = (u8)source;
-
-    return(base);
+    return(memset(base, source, size));
 }
 
-// UNTESTED:
 static void*
 mem_copy(void *base_to, void const *base_from, size_t size) {
-    unsigned char *base_to_ref = (unsigned char *)base_to;
-    unsigned char *base_from_ref = (unsigned char *)base_from;
-    while(size--) *base_to_ref++ = *base_from_ref++;
+    return(memcpy(base_to, base_from, size));
+}
 
-    return(base_to);
+// NOTE: true when both ranges hold the same bytes. Equality only, no ordering.
+static bool
+mem_match(void const* a, void const* b, size_t size){
+    return(memcmp(a, b, size) == 0);
+}
+
+#define CACHE_LINE_SIZE 64
+
+// NOTE: Hints the cpu to start pulling [base, base + size) into cache. Doesn't block and never faults.
+static void
+mem_prefetch(void const* base, size_t size){
+    u8 const* ptr = (u8 const*)AlignDownPow2((u64)base, CACHE_LINE_SIZE);
+    u8 const* opl = (u8 const*)base + size;
+    for(; ptr < opl; ptr += CACHE_LINE_SIZE){
+#if ARCH_AMD64
+        _mm_prefetch((char const*)ptr, _MM_HINT_T0);
+#else
+        __builtin_prefetch(ptr);
+#endif
+    }
 }
 
+///////////////////////////////
+// NOTE: OS Virtual Memory
+///////////////////////////////
+// NOTE: Implemented by the platform layer (win32_memory.h / linux_memory.h).
+// Reserved ranges cost only address space, pages are backed once they are committed.
+static void* os_reserve(u64 size);
+static bool os_commit(void* base, u64 size);
+static void os_decommit(void* base, u64 size);
+static void os_release(void* base, u64 size);
+static bool os_advise_huge_pages(void* base, u64 size);
+
 ///////////////////////////////
 // NOTE: Arena Functions
 ///////////////////////////////
+// NOTE: An arena is a list of blocks, each block starts with its own Arena header. The head arena (the
+// pointer callers hold) tracks the newest block in `current`. When a block runs out, another one is
+// chained on instead of asserting, so arenas only hit a ceiling when the machine does.
+//
+// Two kinds of blocks:
+//     virtual: reserve a large range up front and commit it ARENA_COMMIT_SIZE at a time as it's used.
+//     heap:    calloc'd and fully backed, the fallback chained-block arena (alloc_arena()).
+//
+// usage:
+//     Arena* arena = arena_reserve(GB(1), ArenaFlag_decommit_on_reset);
+//     u64 pos = arena_pos(arena);
+//     push_array(arena, u8, size);
+//     arena_pop_to(arena, pos);
+
+#define ARENA_COMMIT_SIZE KB(64)
+
+typedef enum ArenaFlags{
+    ArenaFlag_virtual             = (1 << 0), // NOTE: blocks are reserved and committed on demand
+    ArenaFlag_fixed               = (1 << 1), // NOTE: never grows, overflow asserts (arena_init(), push_arena())
+    ArenaFlag_decommit_on_reset   = (1 << 2), // NOTE: hand committed pages back to the OS when popped
+} ArenaFlags;
 
 typedef struct Arena{
     // head
     void* base;
-    size_t size;
-    size_t used;
+    size_t size;            // NOTE: usable bytes in this block (reserved, for virtual blocks)
+    size_t used;            // NOTE: relative to this block's base
+    size_t committed;       // NOTE: relative to this block's base
+    size_t block_pos;       // NOTE: arena position this block's base corresponds to
+    size_t high_water;      // NOTE: furthest position ever pushed to, only meaningful on the head arena
+    u32 flags;
+    struct Arena* current;  // NOTE: newest block, only meaningful on the head arena
+    struct Arena* prev;
 } Arena;
 
-// CONSIDER: not sure if I need this, if I have os_alloc_arena()
-static Arena* alloc_arena(size_t size){
-    void* memory = calloc((size + sizeof(Arena)), 1); // 0 initialized
-    Arena* result = (Arena*)memory;
-    result->base = (u8*)memory + sizeof(Arena);
-    result->size = size;
-    result->used = 0;
+static void
+arena_init_block(Arena* block, void* base, size_t size, size_t committed, u32 flags){
+    block->base = base;
+    block->size = size;
+    block->used = 0;
+    block->committed = committed;
+    block->block_pos = 0;
+    block->high_water = 0;
+    block->flags = flags;
+    block->current = block;
+    block->prev = 0;
+}
+
+static Arena*
+arena_alloc_block(size_t size, u32 flags){
+    Arena* result = 0;
+    if(flags & ArenaFlag_virtual){
+        // NOTE: Round the reservation so the header plus usable range covers whole commit granules.
+        u64 reserve_size = AlignUpPow2(size + sizeof(Arena), ARENA_COMMIT_SIZE);
+        void* memory = os_reserve(reserve_size);
+        if(memory && os_commit(memory, ARENA_COMMIT_SIZE)){
+            result = (Arena*)memory;
+            arena_init_block(result, (u8*)memory + sizeof(Arena), reserve_size - sizeof(Arena), ARENA_COMMIT_SIZE - sizeof(Arena), flags);
+        }
+    }
+    else{
+        void* memory = calloc((size + sizeof(Arena)), 1); // 0 initialized
+        if(memory){
+            result = (Arena*)memory;
+            arena_init_block(result, (u8*)memory + sizeof(Arena), size, size, flags);
+        }
+    }
+    return(result);
+}
+
+static void
+arena_free_block(Arena* block){
+    if(block->flags & ArenaFlag_virtual){
+        os_release(block, block->size + sizeof(Arena));
+    }
+    else{
+        free(block);
+    }
+}
+
+// NOTE: Reserves `reserve_size` of address space, only ARENA_COMMIT_SIZE is backed until it's used.
+static Arena*
+arena_reserve(size_t reserve_size, u32 flags){
+    Arena* result = arena_alloc_block(reserve_size, flags | ArenaFlag_virtual);
     return(result);
 }
 
+// NOTE: Chained-block arena, each block is calloc'd in full. Use when reserving address space isn't an option.
+static Arena*
+alloc_arena(size_t size){
+    Arena* result = arena_alloc_block(size, 0);
+    return(result);
+}
+
+static void
+arena_release(Arena* arena){
+    Arena* block = arena->current;
+    while(block){
+        Arena* prev = block->prev;
+        arena_free_block(block);
+        block = prev;
+    }
+}
+
 static void arena_init(Arena* arena, void* base, size_t size){
-    arena->base = base;
-    arena->size = size;
-    arena->used = 0;
+    arena_init_block(arena, base, size, size, ArenaFlag_fixed);
+}
+
+static u64
+arena_pos(Arena* arena){
+    Arena* current = arena->current;
+    u64 result = current->block_pos + current->used;
+    return(result);
+}
+
+static void
+arena_pop_to(Arena* arena, u64 pos){
+    // NOTE: Free whole blocks past pos, the head block is never freed.
+    Arena* current = arena->current;
+    while(current != arena && current->block_pos >= pos){
+        Arena* prev = current->prev;
+        arena_free_block(current);
+        current = prev;
+    }
+    arena->current = current;
+
+    assert(pos - current->block_pos <= current->size);
+    current->used = pos - current->block_pos;
+
+    if((current->flags & (ArenaFlag_virtual|ArenaFlag_decommit_on_reset)) == (ArenaFlag_virtual|ArenaFlag_decommit_on_reset)){
+        // NOTE: Keep the granule that's in use, decommit everything past it.
+        u64 keep = AlignUpPow2(current->used + sizeof(Arena), ARENA_COMMIT_SIZE) - sizeof(Arena);
+        keep = MAX(keep, ARENA_COMMIT_SIZE - sizeof(Arena));
+        if(keep < current->committed){
+            os_decommit((u8*)current->base + keep, current->committed - keep);
+            current->committed = keep;
+        }
+    }
 }
 
 static void arena_free(Arena* arena){
-    arena->used = 0;
+    arena_pop_to(arena, 0);
 }
 
 //#define push_size(arena, size) push_size_aligned(arena, size, _Alignof(max_align_t))
 #define push_array(arena, type, count) (type*)push_size_aligned((arena), sizeof(type) * (count), _Alignof(type))
 #define push_struct(arena, type) (type*)push_size_aligned((arena), sizeof(type), _Alignof(type))
 static void* push_size_aligned(Arena* arena, size_t size, size_t align){
-    size_t used_aligned = AlignUpPow2(arena->used, align);
-    assert((used_aligned + size) <= arena->size);
-    void* result = (u8*)arena->base + used_aligned;
-    arena->used = used_aligned + size;
+    Arena* current = arena->current;
+    // NOTE: Align the address, not the offset, blocks don't all start on the same alignment.
+    size_t used_aligned = AlignUpPow2((u64)current->base + current->used, align) - (u64)current->base;
+    if((used_aligned + size) > current->size){
+        assert(!(current->flags & ArenaFlag_fixed));
+
+        // NOTE: Chain a new block, at least as big as the first one so growth stays amortized.
+        size_t block_size = MAX(current->size, size + align);
+        Arena* block = arena_alloc_block(block_size, current->flags);
+        assert(block);
+        block->block_pos = current->block_pos + current->size;
+        block->prev = current;
+        arena->current = block;
+        current = block;
+        used_aligned = AlignUpPow2((u64)current->base, align) - (u64)current->base;
+    }
+
+    if((used_aligned + size) > current->committed){
+        // NOTE: Commit whole granules, keeping (committed + header) granule aligned.
+        u64 commit_end = AlignUpPow2(used_aligned + size + sizeof(Arena), ARENA_COMMIT_SIZE) - sizeof(Arena);
+        commit_end = MIN(commit_end, current->size);
+        bool committed = os_commit((u8*)current->base + current->committed, commit_end - current->committed);
+        assert(committed);
+        current->committed = commit_end;
+    }
+
+    void* result = (u8*)current->base + used_aligned;
+    current->used = used_aligned + size;
+    arena->high_water = MAX(arena->high_water, current->block_pos + current->used);
     return(result);
 }
 
@@ -77,20 +250,133 @@ static void* push_size_aligned(Arena* arena, size_t size, size_t align){
 //UNTESTED:
 #define pop_array(arena, type, count) pop_array_((arena), sizeof(type) * (count))
 static void pop_array_(Arena* arena, size_t size){
-    arena->used = arena->used - size;
+    arena_pop_to(arena, arena_pos(arena) - size);
 }
 
 static Arena* push_arena(Arena *arena, size_t size){
     Arena* result = push_struct(arena, Arena);
-    result->base = push_array(arena, u8, size);
-    result->size = size;
-    result->used = 0;
+    arena_init(result, push_array(arena, u8, size), size);
+    return(result);
+}
+
+///////////////////////////////
+// NOTE: Pool Functions
+///////////////////////////////
+// NOTE: Fixed size slots carved out of one contiguous reservation, for things like page frames where every
+// allocation is the same size. Slots are aligned to slot_align and packed back to back, no per-slot header.
+// The range is committed POOL_COMMIT_SIZE at a time as new slots are carved. Freed slots go on an
+// intrusive free list, alloc and free are both O(1).
+// With PoolFlag_huge_pages the reservation is aligned and committed in huge pages and the OS is asked to
+// back it with transparent huge pages, fewer TLB entries cover the whole pool.
+//
+// usage:
+//     Pool pool;
+//     pool_init(&pool, KB(4), KB(4), 1024, PoolFlag_huge_pages);
+//     void* slot = pool_alloc(&pool); // 0 when all max_slots are handed out
+//     pool_free(&pool, slot);
+
+#define POOL_COMMIT_SIZE KB(64)
+#define HUGE_PAGE_SIZE MB(2)
+
+typedef enum PoolFlags{
+    PoolFlag_huge_pages = (1 << 0),
+} PoolFlags;
+
+typedef struct PoolSlot{
+    struct PoolSlot* next;
+} PoolSlot;
+
+typedef struct Pool{
+    u8* base;
+    u8* reservation;    // NOTE: what os_reserve returned, base is aligned up from it
+    u64 reserve_size;
+    u64 slot_size;
+    u64 capacity;       // NOTE: bytes from base that slots can be carved from
+    u64 carved;         // NOTE: bytes from base handed out at least once
+    u64 committed;      // NOTE: bytes from base that are backed
+    u64 commit_size;
+    u32 flags;
+    PoolSlot* free_list;
+} Pool;
+
+static bool
+pool_init(Pool* pool, u64 slot_size, u64 slot_align, u64 max_slots, u32 flags){
+    assert(slot_align >= sizeof(PoolSlot) && (slot_align & (slot_align - 1)) == 0);
+    u64 align = slot_align;
+    u64 commit_size = POOL_COMMIT_SIZE;
+    if(flags & PoolFlag_huge_pages){
+        align = MAX(align, HUGE_PAGE_SIZE);
+        commit_size = HUGE_PAGE_SIZE;
+    }
+
+    pool->slot_size = AlignUpPow2(slot_size, slot_align);
+    pool->capacity = AlignUpPow2(pool->slot_size * max_slots, commit_size);
+    pool->carved = 0;
+    pool->committed = 0;
+    pool->commit_size = commit_size;
+    pool->flags = flags;
+    pool->free_list = 0;
+
+    // NOTE: os_reserve is only page aligned, over reserve so base can be aligned up.
+    pool->reserve_size = pool->capacity + align;
+    pool->reservation = (u8*)os_reserve(pool->reserve_size);
+    if(pool->reservation == 0){
+        pool->base = 0;
+        return(false);
+    }
+    pool->base = (u8*)AlignUpPow2((u64)pool->reservation, align);
+    return(true);
+}
+
+static void
+pool_release(Pool* pool){
+    if(pool->reservation){
+        os_release(pool->reservation, pool->reserve_size);
+    }
+    pool->reservation = 0;
+    pool->base = 0;
+    pool->free_list = 0;
+}
+
+// NOTE: Returns 0 when the pool is full. Fresh slots are zero, reused slots hold whatever was freed into them.
+static void*
+pool_alloc(Pool* pool){
+    void* result = 0;
+    if(pool->free_list){
+        PoolSlot* slot = pool->free_list;
+        pool->free_list = slot->next;
+        result = slot;
+    }
+    else if(pool->carved + pool->slot_size <= pool->capacity){
+        if(pool->carved + pool->slot_size > pool->committed){
+            u64 commit_end = AlignUpPow2(pool->carved + pool->slot_size, pool->commit_size);
+            u8* commit_base = pool->base + pool->committed;
+            if(!os_commit(commit_base, commit_end - pool->committed)){
+                return(result);
+            }
+            if(pool->flags & PoolFlag_huge_pages){
+                os_advise_huge_pages(commit_base, commit_end - pool->committed);
+            }
+            pool->committed = commit_end;
+        }
+        result = pool->base + pool->carved;
+        pool->carved += pool->slot_size;
+    }
     return(result);
 }
 
+static void
+pool_free(Pool* pool, void* ptr){
+    if(ptr){
+        PoolSlot* slot = (PoolSlot*)ptr;
+        slot->next = pool->free_list;
+        pool->free_list = slot;
+    }
+}
+
 typedef struct ScratchArena{
     Arena* arena;
-    size_t used;
+    u64 pos;
 } ScratchArena;
 
 #define DEFAULT_RESERVE_SIZE GB(1)
@@ -100,7 +386,7 @@ __thread Arena* scratch_pool[SCRATCH_POOL_COUNT] = {};
 static ScratchArena get_scratch(Arena* arena){
     ScratchArena result;
     result.arena = arena;
-    result.used = arena->used;
+    result.pos = arena_pos(arena);
     return(result);
 }
 
@@ -110,7 +396,7 @@ begin_scratch(u32 index){
     if (scratch_pool[0] == 0){
         Arena **scratch_slot = scratch_pool;
         for (u64 i=0; i < SCRATCH_POOL_COUNT; ++i, scratch_slot +=1){
-            Arena* arena = alloc_arena(DEFAULT_RESERVE_SIZE);
+            Arena* arena = arena_reserve(DEFAULT_RESERVE_SIZE, 0);
             *scratch_slot = arena;
         }
     }
@@ -127,7 +413,7 @@ _begin_scratch(Arena **conflict_array, u32 count){
     if (scratch_pool[0] == 0){
         Arena **scratch_slot = scratch_pool;
         for (u64 i=0; i < SCRATCH_POOL_COUNT; ++i, scratch_slot +=1){
-            Arena* arena = alloc_arena(DEFAULT_RESERVE_SIZE);
+            Arena* arena = arena_reserve(DEFAULT_RESERVE_SIZE, 0);
             *scratch_slot = arena;
         }
     }
@@ -154,7 +440,7 @@ _begin_scratch(Arena **conflict_array, u32 count){
 }
 
 static void end_scratch(ScratchArena scratch){
-    scratch.arena->used = scratch.used;
+    arena_pop_to(scratch.arena, scratch.pos);
 }
 
 //TODO: arena_resize_align
@@ -0,0 +1,164 @@
+#ifndef BASE_PROFILE_H
+#define BASE_PROFILE_H
+
+#include "base_types.h"
+#include "base_memory.h"
+#include "base_string.h"
+#include "base_writer.h"
+#include "base_timer.h"
+
+///////////////////////////////
+// NOTE: Profiler
+///////////////////////////////
+// NOTE: Scoped timing blocks on the cpu timer. Each PROFILE_BLOCK has its own anchor that adds up hits and cycles,
+// inclusive (everything inside the block) and exclusive (minus the blocks nested in it). A block that recurses
+// into itself only counts its outermost call inclusive. With a trace buffer set, every block that ends is also
+// kept as an event for profile_write_trace(), in the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+//
+// Compiled out unless PROFILER is 1, the macros are empty then. Anchors are numbered with __COUNTER__, which
+// counts per translation unit, the unity build is one. The state is global and unsynchronized: only put blocks in
+// code that one thread runs at a time, like the engine.
+//
+// usage:
+//     static void parse(...){
+//         PROFILE_FUNCTION;
+//         ...
+//         { PROFILE_BLOCK("tokenize"); ... }
+//     }
+//     profile_write_report(&writer);
+
+#if !defined(PROFILER)
+# define PROFILER 0
+#endif
+
+#define PROFILE_MAX_ANCHORS 256 // NOTE: anchor 0 is the root, blocks outside any other block are its children
+
+typedef struct ProfileAnchor{
+    char const* label;
+    u64 hits;
+    u64 inclusive;
+    u64 exclusive;
+} ProfileAnchor;
+
+typedef struct ProfileEvent{
+    u32 anchor;
+    u64 begin;
+    u64 duration;
+} ProfileEvent;
+
+typedef struct Profiler{
+    u64 begin; // NOTE: cpu timer at the last profile_reset(), trace times are relative to it
+    u32 parent;
+    ProfileAnchor anchors[PROFILE_MAX_ANCHORS];
+    ProfileEvent* events;
+    u64 event_count;
+    u64 event_max;
+    u64 events_dropped; // NOTE: ended after the trace buffer filled up
+} Profiler;
+
+global Profiler profiler;
+
+#if PROFILER
+struct ProfileBlock{
+    u32 anchor;
+    u32 parent;
+    u64 begin;
+    u64 old_inclusive;
+
+    ProfileBlock(char const* label, u32 anchor_index){
+        assert(anchor_index < PROFILE_MAX_ANCHORS);
+        anchor = anchor_index;
+        parent = profiler.parent;
+        profiler.parent = anchor_index;
+        ProfileAnchor* a = profiler.anchors + anchor_index;
+        a->label = label;
+        old_inclusive = a->inclusive;
+        begin = read_cpu_timer();
+    }
+
+    ~ProfileBlock(){
+        u64 elapsed = read_cpu_timer() - begin;
+        profiler.parent = parent;
+        ProfileAnchor* a = profiler.anchors + anchor;
+        profiler.anchors[parent].exclusive -= elapsed;
+        a->exclusive += elapsed;
+        a->inclusive = old_inclusive + elapsed;
+        a->hits += 1;
+        if(profiler.event_count < profiler.event_max){
+            ProfileEvent* event = profiler.events + profiler.event_count++;
+            event->anchor = anchor;
+            event->begin = begin;
+            event->duration = elapsed;
+        }
+        else if(profiler.events){
+            profiler.events_dropped += 1;
+        }
+    }
+};
+
+# define PROFILE_BLOCK(label) ProfileBlock GLUE(profile_block_, __LINE__)(label, __COUNTER__ + 1)
+# define PROFILE_FUNCTION PROFILE_BLOCK(__func__)
+#else
+# define PROFILE_BLOCK(label)
+# define PROFILE_FUNCTION
+#endif
+
+// NOTE: Clears every anchor and the trace, timing starts over from now.
+static void
+profile_reset(void){
+    mem_set(profiler.anchors, 0, sizeof(profiler.anchors));
+    profiler.parent = 0;
+    profiler.event_count = 0;
+    profiler.events_dropped = 0;
+    profiler.begin = read_cpu_timer();
+}
+
+// NOTE: Keeps the first max_events block ends for profile_write_trace(), later ones are only counted.
+static void
+profile_trace_begin(Arena* arena, u64 max_events){
+    profiler.events = push_array(arena, ProfileEvent, max_events);
+    profiler.event_max = max_events;
+    profiler.event_count = 0;
+    profiler.events_dropped = 0;
+}
+
+// NOTE: One line per block that was hit, in the order they appear in the source.
+static void
+profile_write_report(Writer* w){
+#if PROFILER
+    u64 total = read_cpu_timer() - profiler.begin;
+    f64 frequency = (f64)cpu_timer_frequency();
+    writer_push_format(w, "profile: %.3f ms since reset, cpu timer %.0f MHz\n", ((f64)total * 1000.0) / frequency, frequency / 1000000.0);
+    for(u32 i=1; i < PROFILE_MAX_ANCHORS; ++i){
+        ProfileAnchor* a = profiler.anchors + i;
+        if(a->hits == 0){
+            continue;
+        }
+        f64 exclusive_percent = (100.0 * (f64)a->exclusive) / (f64)total;
+        f64 inclusive_percent = (100.0 * (f64)a->inclusive) / (f64)total;
+        writer_push_format(w, "  %-28s hits %10llu  exclusive %14llu cycles %6.2f%%  inclusive %6.2f%%  %10.1f cycles/hit\n",
+                            a->label, (unsigned long long)a->hits, (unsigned long long)a->exclusive,
+                            exclusive_percent, inclusive_percent, (f64)a->inclusive / (f64)a->hits);
+    }
+#else
+    writer_push_str8(w, str8_literal("profiler is compiled out, build with PROFILER=1\n"));
+#endif
+}
+
+// NOTE: Complete ("X") events, times in microseconds since the last reset. Everything is on one thread lane, the
+// blocks only ever run one thread at a time.
+static void
+profile_write_trace(Writer* w){
+    f64 us_per_tick = 1000000.0 / (f64)cpu_timer_frequency();
+    writer_push_str8(w, str8_literal("{\"traceEvents\":[\n"));
+    for(u64 i=0; i < profiler.event_count; ++i){
+        ProfileEvent* event = profiler.events + i;
+        f64 begin = (f64)(event->begin - profiler.begin) * us_per_tick;
+        f64 duration = (f64)event->duration * us_per_tick;
+        writer_push_format(w, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}%s\n",
+                            profiler.anchors[event->anchor].label, begin, duration, (i + 1 < profiler.event_count) ? "," : "");
+    }
+    writer_push_format(w, "],\"otherData\":{\"events_dropped\":%llu}}\n", (unsigned long long)profiler.events_dropped);
+}
+
+#endif
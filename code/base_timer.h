@@ -0,0 +1,46 @@
+#ifndef BASE_TIMER_H
+#define BASE_TIMER_H
+
+#include "base_types.h"
+
+///////////////////////////////
+// NOTE: CPU Timer
+///////////////////////////////
+
+// NOTE: Raw time stamp counter. Only meaningful as a difference between two reads on the same core. arm64 reads
+// the generic timer's virtual count, which ticks at a fixed rate well below the core clock.
+static u64
+read_cpu_timer(void){
+#if ARCH_AMD64
+    return(__rdtsc());
+#elif ARCH_ARM64 && COMPILER_CL
+    return((u64)_ReadStatusReg(ARM64_CNTVCT));
+#elif ARCH_ARM64
+    u64 result;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(result));
+    return(result);
+#else
+# error read_cpu_timer has no cycle counter for this architecture
+#endif
+}
+
+static u64 os_time_ns(void);
+
+// NOTE: Cpu timer ticks per second, measured once against the OS clock over ~10ms.
+static u64
+cpu_timer_frequency(void){
+    local u64 frequency = u64_max;
+    if(frequency == u64_max){
+        u64 ns_begin = os_time_ns();
+        u64 begin = read_cpu_timer();
+        u64 ns_elapsed = 0;
+        while(ns_elapsed < 10000000){
+            ns_elapsed = os_time_ns() - ns_begin;
+        }
+        u64 ticks = read_cpu_timer() - begin;
+        frequency = (u64)(((f64)ticks * 1000000000.0) / (f64)ns_elapsed);
+    }
+    return(frequency);
+}
+
+#endif
@@ -33,10 +33,20 @@
 # define ARCH_AMD64 1
 #elif defined(_M_I86) || defined(__i386)
 # define ARCH_X86
+#elif defined(_M_ARM64) || defined(__aarch64__)
+# define ARCH_ARM64 1
 #elif defined(_M_ARM) || defined(__arm__)
 # define ARCH_ARM
 #endif
 
+#if ARCH_AMD64 || ARCH_ARM64
+# if OS_WIN
+#  include <intrin.h>
+# elif ARCH_AMD64
+#  include <x86intrin.h>
+# endif
+#endif
+
 // C/C++
 #if defined(__cplusplus)
 # define STANDARD_CPP 1
@@ -49,13 +59,19 @@
 // NOTE: Helper Macros
 ///////////////////////////////
 
+#if OS_WIN
+# define debug_break() __debugbreak()
+#else
+# define debug_break() __builtin_trap()
+#endif
+
 #define ENABLE_ASSERT 1
 #if ENABLE_ASSERT
-# define ASSERT(cond) do { if (!(cond)) __debugbreak(); } while (0)
+# define ASSERT(cond) do { if (!(cond)) debug_break(); } while (0)
 # define ASSERT_HR(hr) ASSERT(SUCCEEDED(hr))
-# define Assert(cond) do { if (!(cond)) __debugbreak(); } while (0)
+# define Assert(cond) do { if (!(cond)) debug_break(); } while (0)
 # define AssertHr(hr) Assert(SUCCEEDED(hr))
-# define assert(cond) do { if (!(cond)) __debugbreak(); } while (0)
+# define assert(cond) do { if (!(cond)) debug_break(); } while (0)
 # define assert_hr(hr) assert(SUCCEEDED(hr))
 #else
 # define ASSERT(cond)
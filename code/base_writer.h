@@ -0,0 +1,150 @@
+#ifndef BASE_WRITER_H
+#define BASE_WRITER_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "base_types.h"
+#include "base_math.h"
+#include "base_memory.h"
+#include "base_string.h"
+
+///////////////////////////////
+// NOTE: Buffered Writer
+///////////////////////////////
+// NOTE: Output is appended to one big buffer and only handed to the flush callback when the buffer is full
+// or on writer_flush(), so dumping lots of small values costs a few large writes instead of one per value.
+// Formatting is done by hand, no printf machinery per value. writer_push_format() is the exception, for reports
+// and other output that isn't on a hot path.
+//
+// usage:
+//     Writer w = writer_make(arena, MB(1), flush_func, user);
+//     writer_push_u64(&w, 42);
+//     writer_push_str8(&w, str8_literal("\n"));
+//     writer_flush(&w);
+
+typedef void WriterFlushFunc(void* user, u8* data, u64 size);
+
+typedef struct Writer{
+    u8* base;
+    u64 size;
+    u64 used;
+    WriterFlushFunc* flush;
+    void* user;
+} Writer;
+
+static Writer
+writer_make(Arena* arena, u64 size, WriterFlushFunc* flush, void* user){
+    Writer result = ZERO_INIT;
+    result.base = push_array(arena, u8, size);
+    result.size = size;
+    result.used = 0;
+    result.flush = flush;
+    result.user = user;
+    return(result);
+}
+
+static void
+writer_flush(Writer* w){
+    if(w->used){
+        w->flush(w->user, w->base, w->used);
+        w->used = 0;
+    }
+}
+
+// NOTE: Makes sure `size` bytes fit without flushing, size must not be larger than the buffer.
+static u8*
+writer_reserve(Writer* w, u64 size){
+    if(w->used + size > w->size){
+        writer_flush(w);
+    }
+    return(w->base + w->used);
+}
+
+static void
+writer_push_bytes(Writer* w, void const* data, u64 size){
+    if(size > w->size){
+        // NOTE: Bigger than the whole buffer, keep the order and pass it straight through.
+        writer_flush(w);
+        w->flush(w->user, (u8*)data, size);
+        return;
+    }
+    u8* dst = writer_reserve(w, size);
+    mem_copy(dst, data, size);
+    w->used += size;
+}
+
+static void
+writer_push_str8(Writer* w, String8 str){
+    writer_push_bytes(w, str.str, str.size);
+}
+
+static void
+writer_push_u8(Writer* w, u8 value){
+    u8* dst = writer_reserve(w, 1);
+    *dst = value;
+    w->used += 1;
+}
+
+// NOTE: Little endian, for binary output.
+static void
+writer_push_u32_le(Writer* w, u32 value){
+    u8* dst = writer_reserve(w, 4);
+    dst[0] = (u8)(value);
+    dst[1] = (u8)(value >> 8);
+    dst[2] = (u8)(value >> 16);
+    dst[3] = (u8)(value >> 24);
+    w->used += 4;
+}
+
+global char const writer_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static void
+writer_push_u64(Writer* w, u64 value){
+    // NOTE: Two digits per divide, written backwards into a scratch then copied out.
+    u8 digits[20];
+    u8* ptr = digits + sizeof(digits);
+    while(value >= 100){
+        u32 pair = (u32)(value % 100) * 2;
+        value /= 100;
+        ptr -= 2;
+        ptr[0] = (u8)writer_digit_pairs[pair];
+        ptr[1] = (u8)writer_digit_pairs[pair + 1];
+    }
+    if(value >= 10){
+        u32 pair = (u32)value * 2;
+        ptr -= 2;
+        ptr[0] = (u8)writer_digit_pairs[pair];
+        ptr[1] = (u8)writer_digit_pairs[pair + 1];
+    }
+    else{
+        *--ptr = (u8)('0' + value);
+    }
+    writer_push_bytes(w, ptr, (u64)(digits + sizeof(digits) - ptr));
+}
+
+static void
+writer_push_s64(Writer* w, s64 value){
+    if(value < 0){
+        writer_push_u8(w, '-');
+        writer_push_u64(w, (u64)0 - (u64)value);
+    }
+    else{
+        writer_push_u64(w, (u64)value);
+    }
+}
+
+// NOTE: printf style, output longer than 255 bytes is cut off.
+static void
+writer_push_format(Writer* w, char const* format, ...){
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    s32 size = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    writer_push_bytes(w, buffer, (u64)CLAMP(0, size, (s32)sizeof(buffer) - 1));
+}
+
+#endif
@@ -0,0 +1,107 @@
+#if !defined(DB_H)
+#define DB_H
+
+// NOTE: Embedding API, implemented by libdb.cpp. Build it as a library instead of the db executable:
+//     clang++ -c -O2 libdb.cpp -o libdb.o && ar rcs libdb.a libdb.o                  (static)
+//     clang++ -shared -fPIC -fvisibility=hidden -O2 libdb.cpp -o libdb.so           (shared)
+// and include this header, it's plain C.
+//
+// usage:
+//     DB* db;
+//     if(db_open("data/mydb.db", &db) != DBResult_ok){ ... db_errmsg(db) ... }
+//     DBStatement* stmt;
+//     db_prepare(db, "select id username where id >= ?", -1, &stmt);
+//     db_bind_u32(stmt, 0, 100);
+//     while(db_step(stmt) == DBResult_row){
+//         uint32_t id = db_column_u32(stmt, 0);
+//         DBView name = db_column_text(stmt, 1); // NOTE: points into the page, valid until the next db_step
+//     }
+//     db_finalize(stmt);
+//     db_close(db);
+//
+// Column views are not null terminated and not copied, they point straight into the pinned leaf page and stay
+// valid until the statement steps again, is reset or finalized. A handle, and every statement prepared on it,
+// must only be used by one thread at a time.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(_WIN32)
+# define DB_API __declspec(dllexport)
+#else
+# define DB_API __attribute__((visibility("default")))
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct DB DB;
+typedef struct DBStatement DBStatement;
+
+typedef enum DBResult{
+    DBResult_ok,
+    DBResult_row,        // NOTE: db_step has a row ready
+    DBResult_done,       // NOTE: db_step ran the statement to completion
+    DBResult_error,      // NOTE: see db_errmsg
+    DBResult_constraint, // NOTE: insert of an id that already exists
+    DBResult_misuse,     // NOTE: bad argument, e.g. a parameter or column index out of range
+} DBResult;
+
+typedef enum DBColumnType{
+    DBColumnType_u32,
+    DBColumnType_text,
+} DBColumnType;
+
+typedef struct DBView{
+    char const* data;
+    size_t size;
+} DBView;
+
+// NOTE: Counters since db_open, plus the shape of the tree right now. Same numbers as the .stats command.
+typedef struct DBStats{
+    uint64_t pages_read;
+    uint64_t pages_written;
+    uint64_t bytes_flushed;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t prefetches;   // NOTE: reads started ahead of a scan, pages they bring in count as hits later
+    uint64_t leaf_splits;
+    uint64_t root_splits;  // NOTE: there are no internal node splits yet, so nothing counts them
+    uint32_t tree_height;
+    uint32_t page_count;
+    uint64_t rows;
+    uint64_t arena_high_water;      // NOTE: bytes, the handle's own arena
+    uint64_t temp_arena_high_water; // NOTE: bytes, the per statement arena shared by every handle
+} DBStats;
+
+// NOTE: Opens or creates the db file at path. *db is set even on failure so db_errmsg can say why, db_close it
+// either way.
+DB_API DBResult db_open(char const* path, DB** db);
+DB_API void db_close(DB* db);
+DB_API char const* db_errmsg(DB* db);
+// NOTE: Walks the tree to count rows, it's a diagnostic, not something to call per statement.
+DB_API DBResult db_stats(DB* db, DBStats* stats);
+
+// NOTE: size < 0 reads sql up to its null terminator. ? marks a parameter, numbered from 0 in order.
+DB_API DBResult db_prepare(DB* db, char const* sql, ptrdiff_t size, DBStatement** statement);
+DB_API uint32_t db_param_count(DBStatement* statement);
+DB_API DBResult db_bind_u32(DBStatement* statement, uint32_t index, uint32_t value);
+DB_API DBResult db_bind_text(DBStatement* statement, uint32_t index, char const* text, size_t size);
+
+DB_API DBResult db_step(DBStatement* statement);
+// NOTE: Back to before the first db_step, bindings are kept.
+DB_API DBResult db_reset(DBStatement* statement);
+DB_API void db_finalize(DBStatement* statement);
+
+DB_API uint32_t db_column_count(DBStatement* statement);
+DB_API char const* db_column_name(DBStatement* statement, uint32_t column);
+DB_API DBColumnType db_column_type(DBStatement* statement, uint32_t column);
+DB_API uint32_t db_column_u32(DBStatement* statement, uint32_t column);
+DB_API DBView db_column_text(DBStatement* statement, uint32_t column);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,415 @@
+// NOTE: End to end benchmarks through the embedding API in db.h. Each workload runs on a fresh db file and times
+// every operation, a prepared statement bound, stepped to completion and reset.
+//
+// Internal nodes don't split yet, so a table tops out at bench_row_capacity rows (about 3.5k). Sizes above it are
+// skipped with a message, and mixed reports the inserts it had to run as lookups once the tree was full.
+//
+// usage:
+//     db_bench [--sizes 1000,3000] [--workloads seq_insert,point_lookup] [--ops N] [--range N] [--scans N]
+//              [--read-pct N] [--seed N] [--file path] [--direct] [--huge-pages] [--json]
+//
+// --json prints one object per line per workload and size instead of the table, for scripts to diff runs.
+#include "libdb.cpp"
+
+typedef enum BenchWorkload{
+    BenchWorkload_seq_insert,
+    BenchWorkload_random_insert,
+    BenchWorkload_point_lookup,  // NOTE: select where id = ?, ids picked uniformly
+    BenchWorkload_range_scan,    // NOTE: select where id >= ? limit range
+    BenchWorkload_full_scan,     // NOTE: select, every row
+    BenchWorkload_mixed,         // NOTE: point lookups, with read_pct% reads and inserts of new ids otherwise
+    BenchWorkload_COUNT,
+} BenchWorkload;
+
+global String8 bench_workload_names[BenchWorkload_COUNT] = {
+    str8_literal("seq_insert"),
+    str8_literal("random_insert"),
+    str8_literal("point_lookup"),
+    str8_literal("range_scan"),
+    str8_literal("full_scan"),
+    str8_literal("mixed"),
+};
+
+#define BENCH_MAX_SIZES 16
+
+global volatile u64 bench_checksum; // NOTE: column reads add into it so they can't be thrown away
+
+typedef struct BenchConfig{
+    u32 sizes[BENCH_MAX_SIZES]; // NOTE: rows in the table
+    u32 size_count;
+    u32 workloads;              // NOTE: bit per BenchWorkload
+    u32 ops;                    // NOTE: lookups and range scans per run, 0 for one per row
+    u32 range;
+    u32 scans;
+    u32 read_pct;
+    u32 seed;
+    char const* path;
+    bool json;
+} BenchConfig;
+
+typedef struct BenchResult{
+    BenchWorkload workload;
+    u32 size;
+    u32 ops;
+    u64* latencies;   // NOTE: cpu timer ticks per op
+    u64 total_ticks;
+    u64 bytes;        // NOTE: logical row bytes written or read, ROW_SIZE a row
+    u64 flush_ticks;  // NOTE: db_close, writing back every dirty page
+    u32 capped_inserts; // NOTE: mixed inserts that ran as lookups instead, the tree was at bench_row_capacity
+} BenchResult;
+
+static u32
+bench_random_u32(u32* state){
+    // NOTE: xorshift32
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return(x);
+}
+
+static void
+bench_shuffle(u32* ids, u32 count, u32* seed){
+    for(u32 i=count; i > 1; --i){
+        u32 j = bench_random_u32(seed) % i;
+        u32 swap = ids[i - 1];
+        ids[i - 1] = ids[j];
+        ids[j] = swap;
+    }
+}
+
+// NOTE: Internal nodes don't split yet, so the tree tops out at one internal root. Every leaf keeps at least
+// the smaller split half, which is how many rows are always guaranteed to fit.
+static u32
+bench_row_capacity(void){
+    return((INTERNAL_NODE_MAX_CELLS + 1) * MIN(LEAF_NODE_LEFT_SPLIT_COUNT, LEAF_NODE_RIGHT_SPLIT_COUNT));
+}
+
+static DB*
+bench_open(BenchConfig* config){
+    remove(config->path);
+    DB* db;
+    if(db_open(config->path, &db) != DBResult_ok){
+        print("db_bench: can't open '%s': %s\n", config->path, db_errmsg(db));
+        exit(EXIT_FAILURE);
+    }
+    return(db);
+}
+
+static DBStatement*
+bench_prepare(DB* db, char const* sql){
+    DBStatement* statement;
+    if(db_prepare(db, sql, -1, &statement) != DBResult_ok){
+        print("db_bench: can't prepare '%s': %s\n", sql, db_errmsg(db));
+        exit(EXIT_FAILURE);
+    }
+    return(statement);
+}
+
+static void
+bench_insert(DBStatement* insert, u32 id){
+    char username[USERNAME_SIZE];
+    char email[64];
+    s32 username_size = snprintf(username, sizeof(username), "user%u", id);
+    s32 email_size = snprintf(email, sizeof(email), "user%u@example.com", id);
+    db_bind_u32(insert, 0, id);
+    db_bind_text(insert, 1, username, (size_t)username_size);
+    db_bind_text(insert, 2, email, (size_t)email_size);
+    DBResult result = db_step(insert);
+    db_reset(insert);
+    if(result != DBResult_done){
+        print("db_bench: insert %u failed: %s\n", id, db_errmsg(insert->db));
+        exit(EXIT_FAILURE);
+    }
+}
+
+// NOTE: Steps a select to the end, touching every column so the rows are really read. Returns the row count.
+static u32
+bench_drain(DBStatement* select){
+    u32 rows = 0;
+    while(db_step(select) == DBResult_row){
+        DBView email = db_column_text(select, 2);
+        bench_checksum += db_column_u32(select, 0) + email.size + (email.size ? (u8)email.data[0] : 0);
+        rows += 1;
+    }
+    db_reset(select);
+    return(rows);
+}
+
+static void
+bench_load(DB* db, u32* ids, u32 count){
+    DBStatement* insert = bench_prepare(db, "insert ? ? ?");
+    for(u32 i=0; i < count; ++i){
+        bench_insert(insert, ids[i]);
+    }
+    db_finalize(insert);
+}
+
+static void
+bench_run(BenchConfig* config, BenchWorkload workload, u32 size, BenchResult* result){
+    u32 seed = config->seed;
+    u32 ops = config->ops ? config->ops : size;
+    switch(workload){
+        case BenchWorkload_seq_insert:
+        case BenchWorkload_random_insert:{
+            ops = size;
+        } break;
+        case BenchWorkload_full_scan:{
+            ops = config->scans;
+        } break;
+        default: break;
+    }
+
+    result->workload = workload;
+    result->size = size;
+    result->ops = ops;
+    result->latencies = push_array(tm, u64, ops);
+    result->bytes = 0;
+    result->capped_inserts = 0;
+
+    // NOTE: mixed loads the even ids and inserts odd ones, everything else works on 1..size. Once the tree is
+    // full mixed only reads.
+    u32* ids = push_array(tm, u32, size);
+    u32 id_step = (workload == BenchWorkload_mixed) ? 2 : 1;
+    for(u32 i=0; i < size; ++i){
+        ids[i] = (i + 1) * id_step;
+    }
+    u32* new_ids = 0;
+    u32 new_id_count = 0;
+    if(workload == BenchWorkload_mixed){
+        new_id_count = MIN(ops, bench_row_capacity() - size);
+        new_ids = push_array(tm, u32, new_id_count);
+        for(u32 i=0; i < new_id_count; ++i){
+            new_ids[i] = i * 2 + 1;
+        }
+        bench_shuffle(new_ids, new_id_count, &seed);
+    }
+    if(workload == BenchWorkload_random_insert){
+        bench_shuffle(ids, size, &seed);
+    }
+
+    DB* db = bench_open(config);
+    bool is_insert = (workload == BenchWorkload_seq_insert || workload == BenchWorkload_random_insert);
+    if(!is_insert){
+        bench_load(db, ids, size);
+    }
+
+    DBStatement* insert = bench_prepare(db, "insert ? ? ?");
+    DBStatement* lookup = bench_prepare(db, "select where id = ?");
+    DBStatement* range = bench_prepare(db, "select where id >= ? limit ?");
+    DBStatement* scan = bench_prepare(db, "select");
+    db_bind_u32(range, 1, config->range);
+
+    u64 rows = 0;
+    u32 inserted = 0;
+    u64 total_begin = read_cpu_timer();
+    for(u32 i=0; i < ops; ++i){
+        u64 begin = read_cpu_timer();
+        switch(workload){
+            case BenchWorkload_seq_insert:
+            case BenchWorkload_random_insert:{
+                bench_insert(insert, ids[i]);
+                rows += 1;
+            } break;
+            case BenchWorkload_point_lookup:{
+                db_bind_u32(lookup, 0, ids[bench_random_u32(&seed) % size]);
+                rows += bench_drain(lookup);
+            } break;
+            case BenchWorkload_range_scan:{
+                db_bind_u32(range, 0, 1 + bench_random_u32(&seed) % size);
+                rows += bench_drain(range);
+            } break;
+            case BenchWorkload_full_scan:{
+                rows += bench_drain(scan);
+            } break;
+            case BenchWorkload_mixed:{
+                bool read = (bench_random_u32(&seed) % 100 < config->read_pct);
+                if(read || inserted == new_id_count){
+                    result->capped_inserts += !read;
+                    db_bind_u32(lookup, 0, ids[bench_random_u32(&seed) % size]);
+                    rows += bench_drain(lookup);
+                }
+                else{
+                    bench_insert(insert, new_ids[inserted++]);
+                    rows += 1;
+                }
+            } break;
+            default: break;
+        }
+        result->latencies[i] = read_cpu_timer() - begin;
+    }
+    result->total_ticks = read_cpu_timer() - total_begin;
+    result->bytes = rows * ROW_SIZE;
+
+    db_finalize(insert);
+    db_finalize(lookup);
+    db_finalize(range);
+    db_finalize(scan);
+    u64 flush_begin = read_cpu_timer();
+    db_close(db);
+    result->flush_ticks = read_cpu_timer() - flush_begin;
+    remove(config->path);
+}
+
+static s32
+bench_compare_u64(void const* a, void const* b){
+    u64 x = *(u64 const*)a;
+    u64 y = *(u64 const*)b;
+    return((x > y) - (x < y));
+}
+
+static f64
+bench_percentile_ns(u64* sorted, u32 count, f64 fraction, f64 ns_per_tick){
+    if(count == 0){
+        return(0);
+    }
+    u32 index = MIN(count - 1, (u32)(fraction * (f64)count));
+    return((f64)sorted[index] * ns_per_tick);
+}
+
+static void
+bench_report(BenchConfig* config, BenchResult* result){
+    f64 ns_per_tick = 1000000000.0 / (f64)cpu_timer_frequency();
+    qsort(result->latencies, result->ops, sizeof(u64), bench_compare_u64);
+
+    f64 seconds = ((f64)result->total_ticks * ns_per_tick) / 1000000000.0;
+    f64 ops_per_sec = seconds > 0 ? (f64)result->ops / seconds : 0;
+    f64 mb_per_sec = seconds > 0 ? ((f64)result->bytes / (f64)MB(1)) / seconds : 0;
+    f64 p50 = bench_percentile_ns(result->latencies, result->ops, 0.50, ns_per_tick);
+    f64 p99 = bench_percentile_ns(result->latencies, result->ops, 0.99, ns_per_tick);
+    f64 p999 = bench_percentile_ns(result->latencies, result->ops, 0.999, ns_per_tick);
+    f64 max = result->ops ? (f64)result->latencies[result->ops - 1] * ns_per_tick : 0;
+    f64 flush_ms = ((f64)result->flush_ticks * ns_per_tick) / 1000000.0;
+    String8 name = bench_workload_names[result->workload];
+
+    if(config->json){
+        print("{\"workload\":\"%.*s\",\"rows\":%u,\"ops\":%u,\"ops_per_sec\":%.1f,\"mb_per_sec\":%.2f,"
+              "\"p50_ns\":%.0f,\"p99_ns\":%.0f,\"p999_ns\":%.0f,\"max_ns\":%.0f,\"flush_ms\":%.3f,\"capped_inserts\":%u}\n",
+              (s32)name.size, name.str, result->size, result->ops, ops_per_sec, mb_per_sec, p50, p99, p999, max, flush_ms,
+              result->capped_inserts);
+    }
+    else{
+        print("%-14.*s %8u %8u %12.0f %9.2f %10.0f %10.0f %10.0f %10.0f %9.3f\n",
+              (s32)name.size, name.str, result->size, result->ops, ops_per_sec, mb_per_sec, p50, p99, p999, max, flush_ms);
+        if(result->capped_inserts > 0){
+            print("  %u inserts ran as lookups, the tree was full at %u rows\n", result->capped_inserts,
+                  bench_row_capacity());
+        }
+    }
+}
+
+static bool
+bench_parse_u32(char const* arg, u32* value){
+    u64 integer;
+    if(!arg || !str8_to_u64(str8_cstring((u8*)arg), &integer) || integer > u32_max){
+        return(false);
+    }
+    *value = (u32)integer;
+    return(true);
+}
+
+s32 main(s32 argc, char** argv){
+    BenchConfig config = ZERO_INIT;
+    config.sizes[config.size_count++] = 1000;
+    config.sizes[config.size_count++] = 3000;
+    config.workloads = (1 << BenchWorkload_COUNT) - 1;
+    config.range = 100;
+    config.scans = 50;
+    config.read_pct = 90;
+    config.seed = 0x9e3779b9;
+    config.path = "db_bench.db";
+
+    for(s32 i=1; i < argc; ++i){
+        String8 arg = str8_cstring((u8*)argv[i]);
+        char const* next = (i + 1 < argc) ? argv[i + 1] : 0;
+        bool ok = true;
+        if(arg == str8_literal("--sizes") && next){
+            String8 rest = str8_cstring((u8*)argv[++i]);
+            config.size_count = 0;
+            for(String8 token = str8_next_token(&rest, str8_literal(",")); token.size > 0;
+                token = str8_next_token(&rest, str8_literal(","))){
+                u64 size;
+                ok = ok && config.size_count < BENCH_MAX_SIZES && str8_to_u64(token, &size) && size > 0 && size <= u32_max;
+                if(ok){
+                    config.sizes[config.size_count++] = (u32)size;
+                }
+            }
+        }
+        else if(arg == str8_literal("--workloads") && next){
+            String8 rest = str8_cstring((u8*)argv[++i]);
+            config.workloads = 0;
+            for(String8 token = str8_next_token(&rest, str8_literal(",")); token.size > 0;
+                token = str8_next_token(&rest, str8_literal(","))){
+                u32 found = BenchWorkload_COUNT;
+                for(u32 w=0; w < BenchWorkload_COUNT; ++w){
+                    if(token == bench_workload_names[w]){
+                        found = w;
+                    }
+                }
+                ok = ok && found != BenchWorkload_COUNT;
+                config.workloads |= ok ? (1 << found) : 0;
+            }
+        }
+        else if(arg == str8_literal("--ops")){
+            ok = bench_parse_u32(argv[++i], &config.ops);
+        }
+        else if(arg == str8_literal("--range")){
+            ok = bench_parse_u32(argv[++i], &config.range);
+        }
+        else if(arg == str8_literal("--scans")){
+            ok = bench_parse_u32(argv[++i], &config.scans);
+        }
+        else if(arg == str8_literal("--read-pct")){
+            ok = bench_parse_u32(argv[++i], &config.read_pct) && config.read_pct <= 100;
+        }
+        else if(arg == str8_literal("--seed")){
+            ok = bench_parse_u32(argv[++i], &config.seed) && config.seed != 0;
+        }
+        else if(arg == str8_literal("--file") && next){
+            config.path = argv[++i];
+        }
+        else if(arg == str8_literal("--direct")){
+            direct_io = true;
+        }
+        else if(arg == str8_literal("--huge-pages")){
+            huge_pages = true;
+        }
+        else if(arg == str8_literal("--json")){
+            config.json = true;
+        }
+        else{
+            ok = false;
+        }
+        if(!ok){
+            print("db_bench: bad argument '%s'\n", argv[MIN(i, argc - 1)]);
+            return(EXIT_FAILURE);
+        }
+    }
+
+    // NOTE: Bigger sizes are skipped rather than run against a tree that can't hold them, see bench_row_capacity.
+    u32 capacity = bench_row_capacity();
+    if(!config.json){
+        print("db_bench: rows are capped at %u until internal nodes split\n", capacity);
+        print("%-14s %8s %8s %12s %9s %10s %10s %10s %10s %9s\n",
+              "workload", "rows", "ops", "ops/sec", "MB/s", "p50 ns", "p99 ns", "p999 ns", "max ns", "flush ms");
+    }
+    for(u32 s=0; s < config.size_count; ++s){
+        u32 size = config.sizes[s];
+        for(u32 w=0; w < BenchWorkload_COUNT; ++w){
+            if(!(config.workloads & (1 << w))){
+                continue;
+            }
+            if(size > capacity){
+                print("db_bench: skipping %.*s at %u rows, the tree only holds %u until internal nodes split\n",
+                      (s32)bench_workload_names[w].size, bench_workload_names[w].str, size, capacity);
+                continue;
+            }
+            BenchResult result;
+            bench_run(&config, (BenchWorkload)w, size, &result);
+            bench_report(&config, &result);
+            arena_free(tm);
+        }
+    }
+    return(0);
+}
@@ -0,0 +1,368 @@
+// NOTE: A client for the binary wire protocol of `db --server`, for the tests and for poking at a server by hand.
+// Reads requests a line at a time, sends all of them at once on one connection (pipelined, after the WIRE_MAGIC
+// handshake), then prints every answer decoded, rows in the repl's text format. Linux only, like server mode.
+//
+// usage:
+//     db_client path/to/socket < requests
+//
+// A request line is one of
+//     prepare <statement>
+//     execute <statement id> [u32 <value> | text <value>]...
+//     close <statement id>
+//     query <statement>
+//     raw <hex bytes>           sent as is, for malformed frames
+//     reconnect                 sends what's queued on its own connection, the rest goes on a new one
+// Empty lines and lines starting with # are skipped. The exit code is 1 when a line can't be parsed, the server's
+// answers don't parse or some requests got no answer.
+#define DB_NO_MAIN 1
+#include "main.cpp"
+
+#if OS_LINUX
+global u64 const CLIENT_BUFFER_SIZE = MB(16);
+global s32 const CLIENT_TIMEOUT_MS = 10000; // NOTE: how long to wait on a server that stopped answering
+
+typedef struct ClientRequest{
+    WireMessage message; // NOTE: 0 for raw bytes
+    u32 statement;       // NOTE: execute only, its rows carry that statement's columns
+    u32 columns;         // NOTE: query only, the columns its rows carry
+} ClientRequest;
+
+typedef struct Client{
+    u8* out;
+    u64 out_size;
+    u8* in;
+    ClientRequest* requests;
+    u32 request_count;
+    u32 statement_columns[CONNECTION_MAX_STATEMENTS]; // NOTE: from the prepared answers, by statement id
+} Client;
+
+static u8*
+client_push(Client* client, u64 size){
+    if(client->out_size + size > CLIENT_BUFFER_SIZE){
+        print("db_client: requests don't fit in %llu bytes\n", (unsigned long long)CLIENT_BUFFER_SIZE);
+        exit(EXIT_FAILURE);
+    }
+    u8* result = client->out + client->out_size;
+    client->out_size += size;
+    return(result);
+}
+
+static void
+client_push_u32(Client* client, u32 value){
+    wire_put_u32(client_push(client, 4), value);
+}
+
+static void
+client_push_str8(Client* client, String8 value){
+    mem_copy(client_push(client, value.size), value.str, value.size);
+}
+
+// NOTE: Starts a frame, the caller pushes the payload and ends it with client_end_frame.
+static u64
+client_begin_frame(Client* client, WireMessage message){
+    u64 result = client->out_size;
+    client_push_u32(client, 0);
+    *client_push(client, 1) = (u8)message;
+    return(result);
+}
+
+static void
+client_end_frame(Client* client, u64 start){
+    wire_put_u32(client->out + start, (u32)(client->out_size - start - 4));
+}
+
+static bool
+client_parse_hex(Client* client, String8 hex){
+    for(String8 token = str8_next_token(&hex, TOKEN_DELIMITERS); token.size != 0;
+        token = str8_next_token(&hex, TOKEN_DELIMITERS)){
+        if(token.size % 2 != 0){
+            return(false);
+        }
+        for(u64 i=0; i < token.size; i += 2){
+            u8 byte = 0;
+            for(u64 j=i; j < i + 2; ++j){
+                u8 c = token.str[j];
+                u8 digit = (c >= '0' && c <= '9') ? (u8)(c - '0') :
+                           (c >= 'a' && c <= 'f') ? (u8)(c - 'a' + 10) :
+                           (c >= 'A' && c <= 'F') ? (u8)(c - 'A' + 10) : 0xff;
+                if(digit == 0xff){
+                    return(false);
+                }
+                byte = (u8)((byte << 4) | digit);
+            }
+            *client_push(client, 1) = byte;
+        }
+    }
+    return(true);
+}
+
+// NOTE: Turns one request line into its frame. Returns false when the line doesn't parse.
+static bool
+client_push_request(Client* client, String8 line, ClientRequest* request){
+    String8 rest = line;
+    String8 kind = str8_next_token(&rest, TOKEN_DELIMITERS);
+    request->statement = 0;
+    request->columns = 0;
+    if(kind == str8_literal("prepare") || kind == str8_literal("query")){
+        // NOTE: The statement is everything after the keyword and one space, sent byte for byte.
+        String8 text = str8_substr_left(line, MIN(kind.size + 1, line.size), line.size);
+        request->message = (kind == str8_literal("prepare")) ? WireMessage_prepare : WireMessage_query;
+        if(request->message == WireMessage_query){
+            Statement statement;
+            if(prepare_statement(text, &statement) == PrepareResult_success && statement.type == StatementType_select){
+                request->columns = statement.columns;
+            }
+        }
+        u64 frame = client_begin_frame(client, request->message);
+        client_push_str8(client, text);
+        client_end_frame(client, frame);
+        return(true);
+    }
+    if(kind == str8_literal("execute") || kind == str8_literal("close")){
+        u64 id = 0;
+        if(!str8_to_u64(str8_next_token(&rest, TOKEN_DELIMITERS), &id) || id > u32_max){
+            return(false);
+        }
+        request->message = (kind == str8_literal("execute")) ? WireMessage_execute : WireMessage_close;
+        request->statement = (u32)id;
+        u64 frame = client_begin_frame(client, request->message);
+        client_push_u32(client, (u32)id);
+        if(request->message == WireMessage_execute){
+            u64 count_at = client->out_size;
+            client_push_u32(client, 0);
+            u32 count = 0;
+            for(String8 type = str8_next_token(&rest, TOKEN_DELIMITERS); type.size != 0;
+                type = str8_next_token(&rest, TOKEN_DELIMITERS)){
+                String8 value = str8_next_token(&rest, TOKEN_DELIMITERS);
+                u64 integer = 0;
+                if(type == str8_literal("u32") && str8_to_u64(value, &integer) && integer <= u32_max){
+                    *client_push(client, 1) = WireParam_u32;
+                    client_push_u32(client, (u32)integer);
+                }
+                else if(type == str8_literal("text") && value.size != 0){
+                    *client_push(client, 1) = WireParam_text;
+                    client_push_u32(client, (u32)value.size);
+                    client_push_str8(client, value);
+                }
+                else{
+                    return(false);
+                }
+                count += 1;
+            }
+            wire_put_u32(client->out + count_at, count);
+        }
+        else if(str8_next_token(&rest, TOKEN_DELIMITERS).size != 0){
+            return(false);
+        }
+        client_end_frame(client, frame);
+        return(true);
+    }
+    if(kind == str8_literal("raw")){
+        request->message = (WireMessage)0;
+        return(client_parse_hex(client, rest));
+    }
+    return(false);
+}
+
+// NOTE: Prints rows in the ResultFormat_binary encoding of columns. False when they don't decode.
+static bool
+client_print_rows(u32 columns, String8 rows){
+    if(!(columns & Column_all)){
+        return(false);
+    }
+    WireReader reader = {rows.str, rows.str + rows.size, true};
+    while(reader.ok && reader.at < reader.end){
+        print("(");
+        bool first = true;
+        if(columns & Column_id){
+            print("%u", wire_read_u32(&reader));
+            first = false;
+        }
+        Column text_columns[] = {Column_username, Column_email};
+        for(u32 i=0; i < array_count(text_columns); ++i){
+            if(columns & text_columns[i]){
+                String8 text = wire_read_str8(&reader, wire_read_u32(&reader));
+                print("%s%.*s", first ? "" : ", ", (s32)text.size, text.str);
+                first = false;
+            }
+        }
+        print(")\n");
+    }
+    return(reader.ok);
+}
+
+// NOTE: Prints every answer in input, which is what the server sent after its magic. Rows are collected until
+// the request's closing answer, a row can be split across frames. Returns how many requests were answered, or
+// u32_max when the answers don't parse.
+static u32
+client_print_answers(Client* client, String8 input){
+    u32 answered = 0;
+    u8* rows = push_array(tm, u8, input.size);
+    u64 rows_size = 0;
+    WireReader reader = {input.str, input.str + input.size, true};
+    while(reader.at < reader.end){
+        u32 size = wire_read_u32(&reader);
+        String8 frame = wire_read_str8(&reader, size);
+        if(!reader.ok || size == 0){
+            print("db_client: truncated frame\n");
+            return(u32_max);
+        }
+        WireReader payload = {frame.str + 1, frame.str + frame.size, true};
+        u8 message = frame.str[0];
+        if(message == WireMessage_rows){
+            mem_copy(rows + rows_size, payload.at, frame.size - 1);
+            rows_size += frame.size - 1;
+            continue;
+        }
+        if(answered == client->request_count){
+            print("db_client: an answer to no request\n");
+            return(u32_max);
+        }
+        ClientRequest* request = client->requests + answered;
+        answered += 1;
+        switch(message){
+            case WireMessage_prepared:{
+                u32 id = wire_read_u32(&payload);
+                u32 params = wire_read_u32(&payload);
+                u32 columns = wire_read_u32(&payload);
+                if(id < CONNECTION_MAX_STATEMENTS){
+                    client->statement_columns[id] = columns;
+                }
+                print("prepared %u, %u params, columns %u\n", id, params, columns);
+            } break;
+            case WireMessage_done:{
+                u32 columns = request->columns;
+                if(request->message == WireMessage_execute && request->statement < CONNECTION_MAX_STATEMENTS){
+                    columns = client->statement_columns[request->statement];
+                }
+                if(rows_size && !client_print_rows(columns, str8(rows, rows_size))){
+                    print("db_client: rows don't decode\n");
+                    return(u32_max);
+                }
+                rows_size = 0;
+                u32 result = wire_read_u32(&payload);
+                u64 rows_low = wire_read_u32(&payload);
+                u64 rows_high = wire_read_u32(&payload);
+                print("done %u, %llu rows\n", result, (unsigned long long)(rows_low | (rows_high << 32)));
+            } break;
+            case WireMessage_error:{
+                u32 error = wire_read_u32(&payload);
+                u32 detail = wire_read_u32(&payload);
+                String8 text = wire_read_rest(&payload);
+                print("error %u, detail %u: %.*s\n", error, detail, (s32)text.size, text.str);
+            } break;
+            default:{
+                print("db_client: unknown message 0x%02x\n", message);
+                return(u32_max);
+            } break;
+        }
+        if(!payload.ok){
+            print("db_client: short payload for message 0x%02x\n", message);
+            return(u32_max);
+        }
+    }
+    return(answered);
+}
+
+// NOTE: Sends the requests queued so far on a new connection, prints the answers and empties the queue. False when
+// the connection failed, the answers don't parse or some requests got no answer.
+static bool
+client_run(Client* client, String8 path){
+    bool result = false;
+    OSSocket socket = os_socket_connect_local(path);
+    if(os_socket_is_valid(socket)){
+        result = os_socket_write(socket, client->out, client->out_size);
+        if(!result){
+            print("db_client: the server closed the connection while sending\n");
+        }
+        os_socket_close_write(socket);
+    }
+
+    // NOTE: The server answers everything it was sent, then sees the end of input and closes.
+    u64 input_size = 0;
+    while(result){
+        s64 count = os_socket_read(socket, client->in + input_size, CLIENT_BUFFER_SIZE - input_size);
+        if(count == OS_SOCKET_WOULD_BLOCK){
+            if(!os_socket_wait_readable(socket, CLIENT_TIMEOUT_MS)){
+                print("db_client: no answer for %d ms\n", CLIENT_TIMEOUT_MS);
+                result = false;
+            }
+            continue;
+        }
+        if(count == 0){
+            break;
+        }
+        input_size += (u64)count;
+    }
+    os_socket_close(socket);
+
+    u32 magic_size = sizeof(WIRE_MAGIC) - 1;
+    if(result && (input_size < magic_size || !mem_match(client->in, WIRE_MAGIC, magic_size))){
+        print("db_client: the server didn't answer the handshake\n");
+        result = false;
+    }
+    if(result){
+        u32 answered = client_print_answers(client, str8(client->in + magic_size, input_size - magic_size));
+        if(answered == u32_max){
+            result = false;
+        }
+        else if(answered < client->request_count){
+            print("connection closed, %u requests got no answer\n", client->request_count - answered);
+            result = false;
+        }
+    }
+
+    client->out_size = 0;
+    client->request_count = 0;
+    client_push_str8(client, str8((u8*)WIRE_MAGIC, sizeof(WIRE_MAGIC) - 1));
+    arena_free(tm);
+    return(result);
+}
+
+s32 main(s32 argc, char** argv){
+    if(argc != 2){
+        print("usage: db_client path/to/socket < requests\n");
+        return(EXIT_FAILURE);
+    }
+    String8 path = str8_cstring((u8*)argv[1]);
+
+    Client* client = push_struct(pm, Client);
+    client->out = push_array(pm, u8, CLIENT_BUFFER_SIZE);
+    client->in = push_array(pm, u8, CLIENT_BUFFER_SIZE);
+    client->out_size = 0;
+    client->requests = push_array(pm, ClientRequest, CLIENT_BUFFER_SIZE / WIRE_FRAME_HEADER_SIZE);
+    client->request_count = 0;
+    client_push_str8(client, str8((u8*)WIRE_MAGIC, sizeof(WIRE_MAGIC) - 1));
+
+    StatementReader reader;
+    statement_reader_init(pm, &reader, os_file_stdin());
+    String8 line;
+    bool ok = true;
+    while(statement_reader_next(&reader, &line)){
+        String8 rest = line;
+        String8 first = str8_next_token(&rest, TOKEN_DELIMITERS);
+        if(first.size == 0 || first.str[0] == '#'){
+            continue;
+        }
+        if(first == str8_literal("reconnect")){
+            ok = client_run(client, path) && ok;
+            print("reconnect\n");
+            continue;
+        }
+        if(!client_push_request(client, line, client->requests + client->request_count)){
+            print("db_client: can't parse line %llu: '%.*s'\n", (unsigned long long)reader.line_number,
+                  (s32)line.size, line.str);
+            ok = false;
+            continue;
+        }
+        client->request_count += 1;
+    }
+    ok = client_run(client, path) && ok;
+    return(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+#else
+s32 main(s32, char**){
+    print("db_client talks to server mode, which is only available on Linux.\n");
+    return(EXIT_FAILURE);
+}
+#endif
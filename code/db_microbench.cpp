@@ -0,0 +1,542 @@
+// NOTE: Microbenchmarks for node level primitives. Builds synthetic pages and reports cycles and ns per operation.
+// Node functions that go through the pager run against a scratch table in db_microbench.db, every page they touch
+// stays resident so no I/O is measured.
+#define DB_NO_MAIN 1
+#include "main.cpp"
+
+global u32 const BENCH_PROBE_COUNT = 4096;
+global u32 const BENCH_REPEAT_COUNT = 256;
+global String8 const BENCH_FILE_NAME = str8_literal("db_microbench.db");
+global volatile u64 bench_sink; // NOTE: results are summed into it so the calls can't be optimized out
+
+// NOTE: Where probe keys come from. Sorted and random probes of the same keys show what branch prediction is
+// worth to a search, misses land between keys.
+typedef enum BenchKeys{
+    BenchKeys_sequential,
+    BenchKeys_random,
+    BenchKeys_miss,
+    BenchKeys_COUNT,
+} BenchKeys;
+
+global char const* bench_keys_names[BenchKeys_COUNT] = {"sequential", "random", "miss"};
+
+static u32
+bench_random_u32(u32* state){
+    // NOTE: xorshift32
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return(x);
+}
+
+// NOTE: fill is cells per node, 0 for cases that don't work on a node.
+static void
+bench_print(char const* name, char const* variant, u32 fill, u64 cycles, f64 calls){
+    f64 ns_per_cycle = 1000000000.0 / (f64)cpu_timer_frequency();
+    f64 cycles_per_call = (f64)cycles / calls;
+    char fill_text[16] = "";
+    if(fill){
+        snprintf(fill_text, sizeof(fill_text), "fill %4u", fill);
+    }
+    print("%-26s %-11s %-9s  %9.2f cycles/op  %8.2f ns/op\n", name, variant, fill_text, cycles_per_call, cycles_per_call * ns_per_cycle);
+}
+
+// NOTE: Keys (i + 1) * 2 for i in [0, key_count), misses are the odd numbers between them.
+static void
+bench_fill_probes(u32* probes, u32 count, u32 key_count, BenchKeys keys, u32* seed){
+    for(u32 i=0; i < count; ++i){
+        switch(keys){
+            case BenchKeys_sequential:{
+                probes[i] = ((i % key_count) + 1) * 2;
+            } break;
+            case BenchKeys_random:{
+                probes[i] = (bench_random_u32(seed) % key_count + 1) * 2;
+            } break;
+            case BenchKeys_miss:{
+                probes[i] = (bench_random_u32(seed) % (key_count + 1)) * 2 + 1;
+            } break;
+            default: break;
+        }
+    }
+}
+
+static void
+bench_fill_row(Row* row, u32 id){
+    mem_set(row, 0, sizeof(*row));
+    row->id = id;
+    snprintf(row->username, USERNAME_SIZE, "user%u", id);
+    snprintf(row->email, EMAIL_SIZE, "user%u@example.com", id);
+}
+
+static void
+bench_fill_leaf(void* node, u32 cell_count){
+    init_leaf_node(node);
+    Row row;
+    for(u32 i=0; i < cell_count; ++i){
+        bench_fill_row(&row, (i + 1) * 2);
+        leaf_node_write_row(node, i, row.id, &row);
+    }
+    *leaf_node_num_cells(node) = cell_count;
+}
+
+// NOTE: A fresh, empty table on a scratch file.
+static void
+bench_table_open(Table* bench_table){
+    os_file_delete(str8_literal(""), BENCH_FILE_NAME);
+    if(!init_table(bench_table) || !db_open(pm, bench_table, str8_literal(""), BENCH_FILE_NAME)){
+        print("db_microbench: can't open %.*s\n", (s32)BENCH_FILE_NAME.size, BENCH_FILE_NAME.str);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void
+bench_table_close(Table* bench_table){
+    db_close(bench_table);
+    os_file_delete(str8_literal(""), BENCH_FILE_NAME);
+}
+
+static u32
+reference_find_child(void* node, u32 key){
+    // NOTE: The old branchy binary search, kept as the baseline and to check results against.
+    u32 min_index = 0;
+    u32 max_index = *internal_node_num_keys(node);
+    while(min_index != max_index){
+        u32 index = (min_index + max_index) / 2;
+        u32 key_to_right = *internal_node_key(node, index);
+        if(key_to_right >= key){
+            max_index = index;
+        }
+        else{
+            min_index = index + 1;
+        }
+    }
+    return(min_index);
+}
+
+static void
+bench_internal_node_find_child(u32 num_keys){
+    Arena* page = os_alloc_arena(PAGE_SIZE);
+    void* node = page->base;
+    init_internal_node(node);
+    *internal_node_num_keys(node) = num_keys;
+    for(u32 i=0; i < num_keys; ++i){
+        *internal_node_key(node, i) = (i + 1) * 2;
+        *internal_node_child(node, i) = i + 1;
+    }
+    *internal_node_right_child(node) = num_keys + 1;
+
+    u32* probes = push_array(tm, u32, BENCH_PROBE_COUNT);
+    u32 seed = 0x9e3779b9;
+    for(u32 i=0; i < BENCH_PROBE_COUNT; ++i){
+        probes[i] = bench_random_u32(&seed) % ((num_keys + 1) * 2 + 1);
+        u32 expected = reference_find_child(node, probes[i]);
+        u32 actual = internal_node_find_child(node, probes[i]);
+        if(expected != actual){
+            print("internal_node_find_child mismatch: keys %d, key %d, expected %d, got %d\n", num_keys, probes[i], expected, actual);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // NOTE: Sum the results so the calls can't be optimized out.
+    u64 sink = 0;
+    u64 begin = read_cpu_timer();
+    for(u32 r=0; r < BENCH_REPEAT_COUNT; ++r){
+        for(u32 i=0; i < BENCH_PROBE_COUNT; ++i){
+            sink += reference_find_child(node, probes[i]);
+        }
+    }
+    u64 reference_cycles = read_cpu_timer() - begin;
+
+    begin = read_cpu_timer();
+    for(u32 r=0; r < BENCH_REPEAT_COUNT; ++r){
+        for(u32 i=0; i < BENCH_PROBE_COUNT; ++i){
+            sink += internal_node_find_child(node, probes[i]);
+        }
+    }
+    u64 cycles = read_cpu_timer() - begin;
+
+    f64 calls = (f64)BENCH_REPEAT_COUNT * (f64)BENCH_PROBE_COUNT;
+    f64 ns_per_cycle = 1000000000.0 / (f64)cpu_timer_frequency();
+    print("internal_node_find_child  keys %4d  branchy %7.2f cycles/descent  simd %7.2f cycles/descent  %6.2f ns/descent  (%llu)\n",
+          num_keys, (f64)reference_cycles / calls, (f64)cycles / calls, ((f64)cycles / calls) * ns_per_cycle, (unsigned long long)(sink & 1));
+    arena_free(tm);
+}
+
+static void
+bench_leaf_node_find(Table* bench_table, u32 cell_count, BenchKeys keys){
+    // NOTE: Through the pager like a real descent, so the pin and frame lookup are part of the cost.
+    u32 page_num = bench_table->root_page_num + 1;
+    PageRef page = get_page(bench_table, page_num);
+    mark_page_dirty(bench_table, &page);
+    bench_fill_leaf(page.node, cell_count);
+
+    u32* probes = push_array(tm, u32, BENCH_PROBE_COUNT);
+    u32 seed = 0x51ed270b;
+    bench_fill_probes(probes, BENCH_PROBE_COUNT, cell_count, keys, &seed);
+
+    u64 sink = 0;
+    u64 begin = read_cpu_timer();
+    for(u32 r=0; r < BENCH_REPEAT_COUNT; ++r){
+        for(u32 i=0; i < BENCH_PROBE_COUNT; ++i){
+            Cursor c = leaf_node_find(bench_table, page_num, probes[i]);
+            sink += c.cell_num;
+            release_page(bench_table, &c.leaf);
+        }
+    }
+    u64 cycles = read_cpu_timer() - begin;
+    release_page(bench_table, &page);
+    bench_sink += sink;
+    bench_print("leaf_node_find", bench_keys_names[keys], cell_count, cycles, (f64)BENCH_REPEAT_COUNT * (f64)BENCH_PROBE_COUNT);
+    arena_free(tm);
+}
+
+// NOTE: Puts back what an insert at position changed: the cells it shifted up and the cell count.
+static void
+bench_restore_leaf(void* node, void* original, u32 position, u32 cell_count){
+    leaf_node_move_cells(node, position, original, position, cell_count - position);
+    *leaf_node_num_cells(node) = cell_count;
+}
+
+// NOTE: Inserts that don't split, where the insert lands decides how many cells shift. Every repeat times a batch
+// of inserts, each followed by putting back only the cells it shifted, and a batch of just the putting back. Each
+// batch keeps its fastest repeat, the difference is the insert.
+static void
+bench_leaf_node_insert(Table* bench_table, u32 cell_count, BenchKeys keys){
+    u32 page_num = bench_table->root_page_num + 1;
+    PageRef page = get_page(bench_table, page_num);
+    mark_page_dirty(bench_table, &page);
+    u8* original = push_array(tm, u8, PAGE_SIZE);
+    bench_fill_leaf(original, cell_count);
+    mem_copy(page.node, original, PAGE_SIZE);
+
+    // NOTE: sequential appends after the last cell, random lands anywhere, miss is reused as insert at the front.
+    u32* positions = push_array(tm, u32, BENCH_PROBE_COUNT);
+    u32 seed = 0x2545f491;
+    for(u32 i=0; i < BENCH_PROBE_COUNT; ++i){
+        switch(keys){
+            case BenchKeys_sequential:  positions[i] = cell_count; break;
+            case BenchKeys_random:      positions[i] = bench_random_u32(&seed) % (cell_count + 1); break;
+            case BenchKeys_miss:        positions[i] = 0; break;
+            default: break;
+        }
+    }
+    Row row;
+    bench_fill_row(&row, 1);
+
+    Cursor c = ZERO_INIT;
+    c.table = bench_table;
+    c.leaf = page;
+    u64 restore_cycles = u64_max;
+    u64 insert_cycles = u64_max;
+    for(u32 r=0; r < BENCH_REPEAT_COUNT; ++r){
+        u64 begin = read_cpu_timer();
+        for(u32 i=0; i < BENCH_PROBE_COUNT; ++i){
+            bench_restore_leaf(page.node, original, positions[i], cell_count);
+        }
+        restore_cycles = MIN(restore_cycles, read_cpu_timer() - begin);
+
+        begin = read_cpu_timer();
+        for(u32 i=0; i < BENCH_PROBE_COUNT; ++i){
+            c.cell_num = positions[i];
+            leaf_node_insert(&c, positions[i] * 2 + 1, &row);
+            bench_restore_leaf(page.node, original, positions[i], cell_count);
+        }
+        insert_cycles = MIN(insert_cycles, read_cpu_timer() - begin);
+    }
+    release_page(bench_table, &page);
+
+    char const* variant = (keys == BenchKeys_sequential) ? "append" : (keys == BenchKeys_random) ? "random" : "front";
+    bench_print("leaf_node_insert", variant, cell_count, insert_cycles - MIN(insert_cycles, restore_cycles), (f64)BENCH_PROBE_COUNT);
+    arena_free(tm);
+}
+
+// NOTE: Puts back what a split of the leaf under a one key root changed: the leaf's cells and header and the
+// root's keys. The new right page is always the one after the tree's three, it's rewritten by every split.
+static void
+bench_restore_split(Table* bench_table, void* root, void* original_root, void* leaf, void* original_leaf){
+    leaf_node_move_cells(leaf, 0, original_leaf, 0, LEAF_NODE_MAX_CELLS);
+    *leaf_node_num_cells(leaf) = LEAF_NODE_MAX_CELLS;
+    *leaf_node_next_leaf(leaf) = *leaf_node_next_leaf(original_leaf);
+    *internal_node_num_keys(root) = 1;
+    for(u32 i=0; i < 2; ++i){
+        *internal_node_key(root, i) = *internal_node_key(original_root, i);
+        *internal_node_child(root, i) = *internal_node_child(original_root, i);
+    }
+    *internal_node_right_child(root) = *internal_node_right_child(original_root);
+    bench_table->num_pages = bench_table->root_page_num + 3;
+}
+
+// NOTE: A full, non root leaf under a one key root, split by an insert at the front, middle or end. Timed like
+// bench_leaf_node_insert: splits with the tree put back after each against putting it back alone, fastest repeat.
+static void
+bench_leaf_node_split_and_insert(Table* bench_table, BenchKeys keys){
+    u32 root_page_num = bench_table->root_page_num;
+    u32 leaf_page_num = root_page_num + 1;
+    u32 right_page_num = root_page_num + 2;
+    PageRef root = get_page(bench_table, root_page_num);
+    PageRef leaf = get_page(bench_table, leaf_page_num);
+    PageRef right = get_page(bench_table, right_page_num);
+    mark_page_dirty(bench_table, &root);
+    mark_page_dirty(bench_table, &leaf);
+    mark_page_dirty(bench_table, &right);
+
+    bench_fill_leaf(right.node, 1);
+    *leaf_node_key(right.node, 0) = u32_max - 1;
+    *node_parent(right.node) = root_page_num;
+    u8* original_leaf = push_array(tm, u8, PAGE_SIZE);
+    bench_fill_leaf(original_leaf, LEAF_NODE_MAX_CELLS);
+    *node_parent(original_leaf) = root_page_num;
+    *leaf_node_next_leaf(original_leaf) = right_page_num;
+    u8* original_root = push_array(tm, u8, PAGE_SIZE);
+    init_internal_node(original_root);
+    set_node_root(original_root, true);
+    *internal_node_num_keys(original_root) = 1;
+    *internal_node_child(original_root, 0) = leaf_page_num;
+    *internal_node_key(original_root, 0) = LEAF_NODE_MAX_CELLS * 2;
+    *internal_node_right_child(original_root) = right_page_num;
+    mem_copy(root.node, original_root, PAGE_SIZE);
+    mem_copy(leaf.node, original_leaf, PAGE_SIZE);
+    bench_table->num_pages = root_page_num + 3;
+
+    u32 position = (keys == BenchKeys_sequential) ? LEAF_NODE_MAX_CELLS : (keys == BenchKeys_random) ? LEAF_NODE_MAX_CELLS / 2 : 0;
+    Row row;
+    bench_fill_row(&row, position * 2 + 1);
+
+    Cursor c = ZERO_INIT;
+    c.table = bench_table;
+    c.leaf = leaf;
+    u64 restore_cycles = u64_max;
+    u64 split_cycles = u64_max;
+    for(u32 r=0; r < BENCH_REPEAT_COUNT; ++r){
+        u64 begin = read_cpu_timer();
+        for(u32 i=0; i < BENCH_PROBE_COUNT; ++i){
+            bench_restore_split(bench_table, root.node, original_root, leaf.node, original_leaf);
+        }
+        restore_cycles = MIN(restore_cycles, read_cpu_timer() - begin);
+
+        begin = read_cpu_timer();
+        for(u32 i=0; i < BENCH_PROBE_COUNT; ++i){
+            c.cell_num = position;
+            leaf_node_split_and_insert(&c, row.id, &row);
+            if(i == 0 && r == 0 && (*internal_node_num_keys(root.node) != 2 || *leaf_node_num_cells(leaf.node) != LEAF_NODE_LEFT_SPLIT_COUNT)){
+                print("leaf_node_split_and_insert: unexpected tree after the split\n");
+                exit(EXIT_FAILURE);
+            }
+            bench_restore_split(bench_table, root.node, original_root, leaf.node, original_leaf);
+        }
+        split_cycles = MIN(split_cycles, read_cpu_timer() - begin);
+    }
+    release_page(bench_table, &right);
+    release_page(bench_table, &leaf);
+    release_page(bench_table, &root);
+
+    char const* variant = (keys == BenchKeys_sequential) ? "end" : (keys == BenchKeys_random) ? "middle" : "front";
+    bench_print("leaf_node_split_and_insert", variant, LEAF_NODE_MAX_CELLS, split_cycles - MIN(split_cycles, restore_cycles), (f64)BENCH_PROBE_COUNT);
+    arena_free(tm);
+}
+
+static void
+bench_serialize_row(void){
+    u32 row_count = 64;
+    Row* rows = push_array(tm, Row, row_count);
+    for(u32 i=0; i < row_count; ++i){
+        bench_fill_row(rows + i, i);
+    }
+    u8* dest = push_array(tm, u8, ROW_SIZE * row_count);
+    u64 begin = read_cpu_timer();
+    for(u32 r=0; r < BENCH_REPEAT_COUNT * 16; ++r){
+        for(u32 i=0; i < row_count; ++i){
+            serialize_row(dest + i * ROW_SIZE, rows + i);
+        }
+        bench_sink += dest[r % (ROW_SIZE * row_count)];
+    }
+    u64 cycles = read_cpu_timer() - begin;
+    // NOTE: bench_fill_row's rows, short username and email with the rest of both columns zero.
+    bench_print("serialize_row", "short_text", 0, cycles, (f64)BENCH_REPEAT_COUNT * 16 * (f64)row_count);
+    arena_free(tm);
+}
+
+// NOTE: A whole table walked the way a scan walks it, cursor_next_leaf per leaf and the cells read from the node.
+// Sequential inserts leave leaves half full, random ones fuller, fill is the average cells per leaf.
+static void
+bench_cursor_walk(u32 row_count, BenchKeys keys){
+    Table* bench_table = push_struct(tm, Table);
+    bench_table_open(bench_table);
+    u32* ids = push_array(tm, u32, row_count);
+    for(u32 i=0; i < row_count; ++i){
+        ids[i] = i + 1;
+    }
+    u32 seed = 0x68e31da4;
+    if(keys == BenchKeys_random){
+        for(u32 i=row_count; i > 1; --i){
+            u32 j = bench_random_u32(&seed) % i;
+            u32 swap = ids[i - 1];
+            ids[i - 1] = ids[j];
+            ids[j] = swap;
+        }
+    }
+    Row row;
+    for(u32 i=0; i < row_count; ++i){
+        bench_fill_row(&row, ids[i]);
+        execute_insert(bench_table, &row);
+    }
+
+    u64 sink = 0;
+    u64 steps = 0;
+    u64 begin = read_cpu_timer();
+    for(u32 r=0; r < 64; ++r){
+        for(Cursor c = cursor_begin(bench_table); cursor_valid(&c); cursor_next_leaf(&c)){
+            void* node = cursor_node(&c);
+            u32 num_cells = *leaf_node_num_cells(node);
+            for(u32 i=c.cell_num; i < num_cells; ++i){
+                sink += *leaf_node_key(node, i);
+                steps += 1;
+            }
+        }
+    }
+    u64 cycles = read_cpu_timer() - begin;
+    u32 leaves = bench_table->num_pages - bench_table->root_page_num - 1;
+    bench_table_close(bench_table);
+    if(steps != (u64)row_count * 64){
+        print("cursor_walk: walked %llu cells, expected %llu\n", (unsigned long long)steps, (unsigned long long)row_count * 64);
+        exit(EXIT_FAILURE);
+    }
+    bench_sink += sink;
+    char variant[32];
+    snprintf(variant, sizeof(variant), "%s/%u", (keys == BenchKeys_random) ? "random" : "seq", row_count);
+    bench_print("cursor_walk", variant, row_count / MAX(1, leaves), cycles, (f64)steps);
+    arena_free(tm);
+}
+
+static u64
+reference_find(String8 haystack, String8 needle){
+    // NOTE: Brute force, only used to check str8_find.
+    for(u64 i=0; i + needle.size <= haystack.size; ++i){
+        if(memcmp(haystack.str + i, needle.str, needle.size) == 0){
+            return(i);
+        }
+    }
+    return(haystack.size);
+}
+
+static void
+check_str8_find(void){
+    // NOTE: Overlapping prefixes are what the old str8_contains got wrong.
+    String8 haystack = str8_literal("aaab");
+    String8 needle = str8_literal("aab");
+    if(!str8_contains(haystack, needle) || str8_find(haystack, needle) != 1){
+        print("str8_find: missed an overlapping prefix\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // NOTE: Small alphabet so partial matches are common, lengths on both sides of the register widths and of
+    // the 64 byte masked needle compare.
+    u8* buffer = push_array(tm, u8, 400);
+    u8* pattern = push_array(tm, u8, 80);
+    u32 seed = 0x1234567;
+    for(u32 round=0; round < 40000; ++round){
+        u32 size = bench_random_u32(&seed) % 400;
+        u32 needle_size = 1 + bench_random_u32(&seed) % 80;
+        for(u32 i=0; i < size; ++i){
+            buffer[i] = 'a' + bench_random_u32(&seed) % 2;
+        }
+        for(u32 i=0; i < needle_size; ++i){
+            pattern[i] = 'a' + bench_random_u32(&seed) % 2;
+        }
+        String8 h = str8(buffer, size);
+        String8 n = str8(pattern, needle_size);
+        u64 expected = reference_find(h, n);
+        u64 actual = str8_find(h, n);
+        if(expected != actual){
+            print("str8_find mismatch: size %d, needle %d, expected %llu, got %llu\n", size, needle_size, (unsigned long long)expected, (unsigned long long)actual);
+            exit(EXIT_FAILURE);
+        }
+    }
+    arena_free(tm);
+}
+
+// NOTE: Best of BENCH_BYTES_RUNS runs, a single run on a shared machine mostly measured its neighbours.
+#define BENCH_BYTES_RUNS 5
+#define BENCH_BYTES(label, size, repeat, expr) do{ \
+    u64 cycles_ = u64_max; \
+    for(u32 run_=0; run_ < BENCH_BYTES_RUNS; ++run_){ \
+        u64 begin_ = read_cpu_timer(); \
+        for(u32 r_=0; r_ < (repeat); ++r_){ expr; } \
+        cycles_ = MIN(cycles_, read_cpu_timer() - begin_); \
+    } \
+    print("  %-10s %8.2f cycles/call  %6.2f bytes/cycle\n", label, (f64)cycles_ / (f64)(repeat), ((f64)(size) * (f64)(repeat)) / (f64)cycles_); \
+} while(0)
+
+static void
+bench_mem_primitives(u32 size){
+    // NOTE: Each base function against its libc counterpart. The volatile sink keeps results alive.
+    u32 repeat = MAX(64, MB(16) / (size + 1));
+    u8* a = push_array(tm, u8, size + 64);
+    u8* b = push_array(tm, u8, size + 64);
+    u32 seed = 0xC0FFEE;
+    for(u32 i=0; i < size; ++i){
+        a[i] = 'a' + (bench_random_u32(&seed) % 26);
+        b[i] = a[i];
+    }
+    a[size] = 0;
+    b[size] = 0;
+    // NOTE: A needle that only shows up at the very end, after lots of first byte hits.
+    String8 haystack = str8(a, size);
+    String8 needle = str8_slice_left(haystack, MIN(size, 12));
+    volatile u64 sink = 0;
+
+    print("size %d  (avx2 %d, avx512bw %d)\n", size, (cpu_features() & CPUFeature_avx2) ? 1 : 0, (cpu_features() & CPUFeature_avx512bw) ? 1 : 0);
+    BENCH_BYTES("mem_set", size, repeat, mem_set(b, r_, size); sink += b[0]);
+    BENCH_BYTES("memset", size, repeat, memset(b, r_, size); sink += b[0]);
+    BENCH_BYTES("mem_copy", size, repeat, mem_copy(b, a, size); sink += b[0]);
+    BENCH_BYTES("memcpy", size, repeat, memcpy(b, a, size); sink += b[0]);
+    BENCH_BYTES("mem_match", size, repeat, sink += mem_match(a, b, size));
+    BENCH_BYTES("memcmp", size, repeat, sink += (memcmp(a, b, size) == 0));
+    BENCH_BYTES("str_length", size, repeat, sink += str_length(a));
+    BENCH_BYTES("strlen", size, repeat, sink += strlen((char*)a));
+    BENCH_BYTES("str8_find", size, repeat, sink += str8_find(haystack, needle));
+    BENCH_BYTES("strstr", size, repeat, sink += (u64)strstr((char*)a, (char*)needle.str));
+    arena_free(tm);
+}
+
+s32 main(s32, char**){
+    u32 fill_levels[] = {1, 4, 16, 17, 64, INTERNAL_NODE_MAX_CELLS};
+    for(u32 i=0; i < array_count(fill_levels); ++i){
+        bench_internal_node_find_child(fill_levels[i]);
+    }
+
+    Table* bench_table = push_struct(pm, Table);
+    bench_table_open(bench_table);
+    u32 leaf_fill_levels[] = {1, 4, LEAF_NODE_LEFT_SPLIT_COUNT, LEAF_NODE_MAX_CELLS};
+    for(u32 keys=0; keys < BenchKeys_COUNT; ++keys){
+        for(u32 i=0; i < array_count(leaf_fill_levels); ++i){
+            bench_leaf_node_find(bench_table, leaf_fill_levels[i], (BenchKeys)keys);
+        }
+    }
+    for(u32 keys=0; keys < BenchKeys_COUNT; ++keys){
+        for(u32 i=0; i < array_count(leaf_fill_levels); ++i){
+            bench_leaf_node_insert(bench_table, leaf_fill_levels[i] - 1, (BenchKeys)keys);
+        }
+    }
+    for(u32 keys=0; keys < BenchKeys_COUNT; ++keys){
+        bench_leaf_node_split_and_insert(bench_table, (BenchKeys)keys);
+    }
+    bench_table_close(bench_table);
+
+    bench_serialize_row();
+    u32 row_counts[] = {100, 3000};
+    for(u32 i=0; i < array_count(row_counts); ++i){
+        bench_cursor_walk(row_counts[i], BenchKeys_sequential);
+        bench_cursor_walk(row_counts[i], BenchKeys_random);
+    }
+
+    check_str8_find();
+    // NOTE: 32 and 255 are the username and email column widths, what a like scan searches.
+    u32 sizes[] = {15, 32, 64, 255, 300, 4096, 65536};
+    for(u32 i=0; i < array_count(sizes); ++i){
+        bench_mem_primitives(sizes[i]);
+    }
+    return(0);
+}
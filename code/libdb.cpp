@@ -0,0 +1,339 @@
+// NOTE: The db engine as a library, the C API from db.h on top of the same unity build as the executable.
+// See db.h for how to build and use it.
+#define DB_NO_MAIN 1
+#include "main.cpp"
+#include "db.h"
+
+#define DB_MAX_STATEMENTS 1024 // NOTE: prepared statements alive at once per handle
+#define DB_ERROR_SIZE 256
+
+global u64 const DB_ARENA_SIZE = MB(16);
+
+struct DB{
+    Arena* arena;
+    Table table;
+    bool open;
+    Pool statements;
+    char error[DB_ERROR_SIZE];
+};
+
+typedef enum DBStatementState{
+    DBStatementState_ready,
+    DBStatementState_running, // NOTE: the vm is paused on a row, its leaf is pinned
+    DBStatementState_done,
+} DBStatementState;
+
+struct DBStatement{
+    DB* db;
+    Statement statement;
+    Program program;
+    VM vm;
+    DBStatementState state;
+    u32 column_count;
+    Column columns[3]; // NOTE: the projection in output order
+};
+
+static void
+db_set_error(DB* db, String8 message){
+    u64 size = MIN(message.size, DB_ERROR_SIZE - 1);
+    mem_copy(db->error, message.str, size);
+    db->error[size] = 0;
+}
+
+static String8
+prepare_result_message(PrepareResult result){
+    switch(result){
+        case PrepareResult_success:                 return(str8_literal("not an error"));
+        case PrepareResult_unrecognized_statement:  return(str8_literal("unrecognized statement"));
+        case PrepareResult_syntax_error:            return(str8_literal("syntax error, could not parse statement"));
+        case PrepareResult_negative_id:             return(str8_literal("id must be positive"));
+        case PrepareResult_username_too_long:       return(str8_literal("username is too long"));
+        case PrepareResult_email_too_long:          return(str8_literal("email is too long"));
+    }
+    return(str8_literal("unknown error"));
+}
+
+// NOTE: Stops a paused vm early, releases the leaf it has pinned. Only the library runs a vm without a sink, so
+// only it can leave one paused on a row.
+static void
+vm_abort(VM* vm){
+    cursor_close(&vm->cursor);
+}
+
+static bool
+db_statement_has_column(DBStatement* statement, u32 column, Column type){
+    return(statement->state == DBStatementState_running && column < statement->column_count &&
+           statement->columns[column] == type);
+}
+
+///////////////////////////////
+// NOTE: Handles
+///////////////////////////////
+
+DB_API DBResult
+db_open(char const* path, DB** db_out){
+    Arena* arena = arena_reserve(DB_ARENA_SIZE, 0);
+    DB* db = push_struct(arena, DB);
+    db->arena = arena;
+    db->open = false;
+    db->error[0] = 0;
+    *db_out = db;
+
+    if(!pool_init(&db->statements, sizeof(DBStatement), _Alignof(DBStatement), DB_MAX_STATEMENTS, 0)){
+        db_set_error(db, str8_literal("failed to reserve statement memory"));
+        return(DBResult_error);
+    }
+    if(!init_table(&db->table)){
+        db_set_error(db, str8_literal("failed to reserve the frame pool"));
+        return(DBResult_error);
+    }
+    if(!db_open(arena, &db->table, str8_literal(""), str8_cstring((u8*)path))){
+        pool_release(&db->table.frame_pool);
+        db_set_error(db, str8_literal("failed to open the db file, or it's not a db file"));
+        return(DBResult_error);
+    }
+    db->open = true;
+    return(DBResult_ok);
+}
+
+// NOTE: Flushes every dirty page. Statements still alive are dropped with the handle.
+DB_API void
+db_close(DB* db){
+    if(!db){
+        return;
+    }
+    if(db->open){
+        db_close(&db->table);
+    }
+    pool_release(&db->statements);
+    arena_release(db->arena);
+}
+
+DB_API char const*
+db_errmsg(DB* db){
+    return(db->error);
+}
+
+DB_API DBResult
+db_stats(DB* db, DBStats* stats){
+    if(!db->open){
+        db_set_error(db, str8_literal("db is not open"));
+        return(DBResult_misuse);
+    }
+    TableStats table_stats;
+    table_collect_stats(&db->table, db->arena, &table_stats);
+    stats->pages_read = table_stats.counters.pages_read;
+    stats->pages_written = table_stats.counters.pages_written;
+    stats->bytes_flushed = table_stats.counters.bytes_flushed;
+    stats->cache_hits = table_stats.counters.cache_hits;
+    stats->cache_misses = table_stats.counters.cache_misses;
+    stats->prefetches = table_stats.counters.prefetches;
+    stats->leaf_splits = table_stats.counters.leaf_splits;
+    stats->root_splits = table_stats.counters.root_splits;
+    stats->tree_height = table_stats.tree_height;
+    stats->page_count = table_stats.page_count;
+    stats->rows = table_stats.rows;
+    stats->arena_high_water = table_stats.arena_high_water;
+    stats->temp_arena_high_water = table_stats.temp_arena_high_water;
+    return(DBResult_ok);
+}
+
+///////////////////////////////
+// NOTE: Statements
+///////////////////////////////
+
+DB_API DBResult
+db_prepare(DB* db, char const* sql, ptrdiff_t size, DBStatement** statement_out){
+    *statement_out = 0;
+    if(!db->open){
+        db_set_error(db, str8_literal("db is not open"));
+        return(DBResult_misuse);
+    }
+    DBStatement* statement = (DBStatement*)pool_alloc(&db->statements);
+    if(!statement){
+        db_set_error(db, str8_literal("too many prepared statements"));
+        return(DBResult_error);
+    }
+    String8 input = (size < 0) ? str8_cstring((u8*)sql) : str8((u8*)sql, (u64)size);
+    PrepareResult result = prepare_statement(input, &statement->statement);
+    if(result != PrepareResult_success){
+        pool_free(&db->statements, statement);
+        db_set_error(db, prepare_result_message(result));
+        return(DBResult_error);
+    }
+
+    statement->db = db;
+    statement->state = DBStatementState_ready;
+    statement->column_count = 0;
+    if(statement->statement.type == StatementType_select){
+        Column columns[] = {Column_id, Column_username, Column_email};
+        for(u32 i=0; i < array_count(columns); ++i){
+            if(statement->statement.columns & columns[i]){
+                statement->columns[statement->column_count++] = columns[i];
+            }
+        }
+    }
+    compile_statement(&statement->statement, &statement->program);
+    *statement_out = statement;
+    return(DBResult_ok);
+}
+
+DB_API uint32_t
+db_param_count(DBStatement* statement){
+    return(statement->statement.param_count);
+}
+
+DB_API DBResult
+db_bind_u32(DBStatement* statement, uint32_t index, uint32_t value){
+    if(statement->state == DBStatementState_running){
+        db_set_error(statement->db, str8_literal("bind on a running statement, reset it first"));
+        return(DBResult_misuse);
+    }
+    if(statement_bind_u32(&statement->statement, index, value) != PrepareResult_success){
+        db_set_error(statement->db, str8_literal("parameter index out of range or not an integer"));
+        return(DBResult_misuse);
+    }
+    return(DBResult_ok);
+}
+
+DB_API DBResult
+db_bind_text(DBStatement* statement, uint32_t index, char const* text, size_t size){
+    if(statement->state == DBStatementState_running){
+        db_set_error(statement->db, str8_literal("bind on a running statement, reset it first"));
+        return(DBResult_misuse);
+    }
+    PrepareResult result = statement_bind_str8(&statement->statement, index, str8((u8*)text, size));
+    if(result != PrepareResult_success){
+        db_set_error(statement->db, prepare_result_message(result));
+        return((index < statement->statement.param_count) ? DBResult_error : DBResult_misuse);
+    }
+    return(DBResult_ok);
+}
+
+DB_API DBResult
+db_step(DBStatement* statement){
+    DB* db = statement->db;
+    VM* vm = &statement->vm;
+    switch(statement->state){
+        case DBStatementState_done:{
+            db_set_error(db, str8_literal("statement already ran to completion, reset it first"));
+            return(DBResult_misuse);
+        } break;
+        case DBStatementState_ready:{
+            if(!statement_is_bound(&statement->statement)){
+                db_set_error(db, str8_literal("statement has unbound parameters"));
+                return(DBResult_misuse);
+            }
+            if(db->table.io_failed){
+                db_set_error(db, str8_literal("a page read or write failed, close and reopen the db"));
+                return(DBResult_error);
+            }
+            // NOTE: No sink, the vm stops at each row and leaves it in place for the column accessors.
+            vm_init(vm, &db->table, &statement->program, 0);
+            statement->state = DBStatementState_running;
+        } break;
+        case DBStatementState_running:{
+        } break;
+    }
+
+    if(vm_run(vm) == VMStatus_row){
+        return(DBResult_row);
+    }
+    statement->state = DBStatementState_done;
+    switch(vm->result){
+        case ExecuteResult_success:{
+            return(DBResult_done);
+        } break;
+        case ExecuteResult_duplicate_key:{
+            db_set_error(db, str8_literal("duplicate key"));
+            return(DBResult_constraint);
+        } break;
+        case ExecuteResult_table_full:{
+            db_set_error(db, str8_literal("table full"));
+            return(DBResult_error);
+        } break;
+        case ExecuteResult_unbound_parameter:{
+            db_set_error(db, str8_literal("statement has unbound parameters"));
+            return(DBResult_misuse);
+        } break;
+        case ExecuteResult_io_error:{
+            db_set_error(db, str8_literal("a page read or write failed, close and reopen the db"));
+            return(DBResult_error);
+        } break;
+    }
+    return(DBResult_error);
+}
+
+DB_API DBResult
+db_reset(DBStatement* statement){
+    if(statement->state == DBStatementState_running){
+        vm_abort(&statement->vm);
+    }
+    statement->state = DBStatementState_ready;
+    return(DBResult_ok);
+}
+
+DB_API void
+db_finalize(DBStatement* statement){
+    if(!statement){
+        return;
+    }
+    db_reset(statement);
+    pool_free(&statement->db->statements, statement);
+}
+
+///////////////////////////////
+// NOTE: Columns
+///////////////////////////////
+// NOTE: Only valid while db_step's last answer was DBResult_row. Reads go straight to the pinned leaf, nothing
+// is copied into a Row. A wrong index or type gets 0 or an empty view.
+
+DB_API uint32_t
+db_column_count(DBStatement* statement){
+    return(statement->column_count);
+}
+
+DB_API char const*
+db_column_name(DBStatement* statement, uint32_t column){
+    if(column >= statement->column_count){
+        return(0);
+    }
+    switch(statement->columns[column]){
+        case Column_id:         return("id");
+        case Column_username:   return("username");
+        case Column_email:      return("email");
+        default: break;
+    }
+    return(0);
+}
+
+DB_API DBColumnType
+db_column_type(DBStatement* statement, uint32_t column){
+    bool is_id = (column < statement->column_count && statement->columns[column] == Column_id);
+    return(is_id ? DBColumnType_u32 : DBColumnType_text);
+}
+
+DB_API uint32_t
+db_column_u32(DBStatement* statement, uint32_t column){
+    if(!db_statement_has_column(statement, column, Column_id)){
+        return(0);
+    }
+    VM* vm = &statement->vm;
+    return(*leaf_node_id(vm->row_node, vm->row_cell));
+}
+
+DB_API DBView
+db_column_text(DBStatement* statement, uint32_t column){
+    DBView result = {0, 0};
+    VM* vm = &statement->vm;
+    String8 text = ZERO_INIT;
+    if(db_statement_has_column(statement, column, Column_username)){
+        text = column_string(leaf_node_username(vm->row_node, vm->row_cell), USERNAME_SIZE);
+    }
+    else if(db_statement_has_column(statement, column, Column_email)){
+        text = column_string(leaf_node_email(vm->row_node, vm->row_cell), EMAIL_SIZE);
+    }
+    result.data = (char const*)text.str;
+    result.size = text.size;
+    return(result);
+}
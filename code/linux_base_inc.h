@@ -0,0 +1,11 @@
+#if !defined(LINUX_BASE_H)
+#define LINUX_BASE_H
+
+#include "linux_memory.h"
+#include "linux_file.h"
+#include "linux_thread.h"
+#include "linux_io.h"
+#include "linux_net.h"
+#include "linux_time.h"
+
+#endif
@@ -0,0 +1,336 @@
+#if !defined(LINUX_FILE_H)
+#define LINUX_FILE_H
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include "base_types.h"
+#include "base_memory.h"
+#include "base_string.h"
+
+// TODO: This probably needs to be part if an print logging file
+#include <stdio.h>
+static void
+print(char const* format, ...) {
+    char buffer[4096] = {};
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    printf("%s", buffer);
+}
+
+// NOTE: Raw write to stdout, bypasses stdio. Anything print() still has buffered goes out first so the two
+// don't interleave out of order.
+static void
+os_write_stdout(void* data, u64 size){
+    fflush(stdout);
+    u8* ptr = (u8*)data;
+    while(size > 0){
+        ssize_t written = write(STDOUT_FILENO, ptr, size);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return;
+        }
+        ptr += written;
+        size -= (u64)written;
+    }
+}
+
+static String8
+read_stdin(Arena* arena){
+    u8* str = push_array(arena, u8, KB(1));
+    if(fgets((char*)str, KB(1), stdin) == 0){
+        str[0] = 0;
+    }
+    u64 length = str_length((char*)str);
+    pop_array(arena, u8, (KB(1)-length-1));
+    String8 result = str8(str, length);
+
+    return(result);
+}
+
+///////////////////////////////
+// NOTE: Linux File Paths
+///////////////////////////////
+
+// NOTE: Paths are passed around as utf8 already, we only need a null terminated copy for the syscalls.
+static char*
+os_path_cstring(Arena* arena, String8 dir, String8 file_name){
+    char* result = push_array(arena, char, dir.size + file_name.size + 1);
+    mem_copy(result, dir.str, dir.size);
+    mem_copy(result + dir.size, file_name.str, file_name.size);
+    result[dir.size + file_name.size] = 0;
+    return(result);
+}
+
+static String8
+os_get_cwd(Arena* arena){
+    ScratchArena scratch = begin_scratch(0);
+    char* buffer = push_array(scratch.arena, char, KB(4));
+    if(getcwd(buffer, KB(4)) == 0){
+        buffer[0] = 0;
+    }
+
+    u32 length = str_length(buffer);
+    u8* str = push_array(arena, u8, length + 1);
+    mem_copy(str, buffer, length + 1);
+    String8 result = str8(str, length);
+    end_scratch(scratch);
+    return(result);
+}
+
+///////////////////////////////
+// NOTE: Linux File I/O
+///////////////////////////////
+
+typedef struct FileData{
+    void* base;
+    u64 size;
+} FileData;
+
+static FileData
+os_file_read(Arena* arena, String8 dir, String8 file_name){
+    FileData result = ZERO_INIT;
+    ScratchArena scratch = begin_scratch(0);
+    char* full_path = os_path_cstring(scratch.arena, dir, file_name);
+
+    s32 fd = open(full_path, O_RDWR|O_CREAT, 0644);
+    end_scratch(scratch);
+    if(fd < 0){
+        print("os_file_read: failed to create file handle - error: %d\n", errno);
+        return(result);
+    }
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0){
+        print("os_file_read: failed to get file size\n");
+        close(fd);
+        return(result);
+    }
+
+    u64 file_size = (u64)file_stat.st_size;
+    result.base = push_array(arena, u8, file_size);
+    u64 bytes_read = 0;
+    while(bytes_read < file_size){
+        ssize_t count = pread(fd, (u8*)result.base + bytes_read, file_size - bytes_read, bytes_read);
+        if(count <= 0){
+            print("os_file_read: failed to read file\n");
+            close(fd);
+            return(result);
+        }
+        bytes_read += count;
+    }
+
+    result.size = file_size;
+    close(fd);
+    return(result);
+}
+
+static bool
+os_file_write(FileData data, String8 dir, String8 file_name, u64 offset){
+    bool result = false;
+    ScratchArena scratch = begin_scratch(0);
+    char* full_path = os_path_cstring(scratch.arena, dir, file_name);
+
+    s32 fd = open(full_path, O_WRONLY|O_CREAT, 0644);
+    end_scratch(scratch);
+    if(fd < 0){
+        print("os_file_write: failed to create file handle\n");
+        return(result);
+    }
+
+    ssize_t bytes_written = pwrite(fd, data.base, data.size, offset);
+    if(bytes_written < 0){
+        print("os_file_write: failed to write data to file\n");
+        close(fd);
+        return(result);
+    }
+
+    result = (data.size == (u64)bytes_written);
+    close(fd);
+    return(result);
+}
+
+///////////////////////////////
+// NOTE: Linux Open Files
+///////////////////////////////
+// NOTE: For files that stay open and are accessed by offset through an IOQueue (linux_io.h).
+
+typedef struct OSFile{
+    u64 handle;
+} OSFile;
+
+typedef enum OSFileFlag{
+    OSFileFlag_direct = (1 << 0), // NOTE: bypass the OS page cache. Buffers, offsets and sizes must be multiples of os_file_block_size()
+    OSFileFlag_sequential = (1 << 1), // NOTE: read only and must already exist, read front to back with os_file_read_next()
+    OSFileFlag_quiet = (1 << 2), // NOTE: a failed open prints nothing, for callers that try another way next
+} OSFileFlag;
+
+static OSFile
+os_file_open(String8 dir, String8 file_name, u32 flags){
+    OSFile result = ZERO_INIT;
+    ScratchArena scratch = begin_scratch(0);
+    char* full_path = os_path_cstring(scratch.arena, dir, file_name);
+
+    s32 open_flags = O_RDWR|O_CREAT;
+    if(flags & OSFileFlag_sequential){
+        open_flags = O_RDONLY;
+    }
+    if(flags & OSFileFlag_direct){
+        open_flags |= O_DIRECT;
+    }
+    s32 fd = open(full_path, open_flags, 0644);
+    end_scratch(scratch);
+    if(fd < 0){
+        if(!(flags & OSFileFlag_quiet)){
+            print("os_file_open: failed to create file handle - error: %d\n", errno);
+        }
+        return(result);
+    }
+    if(flags & OSFileFlag_sequential){
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    // NOTE: fd 0 is stdin, so store fd + 1 and keep 0 as the invalid handle.
+    result.handle = (u64)fd + 1;
+    return(result);
+}
+
+static s32
+os_file_fd(OSFile file){
+    return((s32)file.handle - 1);
+}
+
+// NOTE: stdin as an OSFile, for os_file_read_next(). Don't os_file_close() it.
+static OSFile
+os_file_stdin(void){
+    OSFile result = {(u64)STDIN_FILENO + 1};
+    return(result);
+}
+
+static bool
+os_file_is_interactive(OSFile file){
+    return(isatty(os_file_fd(file)) == 1);
+}
+
+// NOTE: Reads from the current position and advances it. Returns bytes read, 0 at end of file, < 0 on failure.
+// Short reads are normal for pipes and terminals.
+static s64
+os_file_read_next(OSFile file, void* buffer, u64 size){
+    for(;;){
+        ssize_t count = read(os_file_fd(file), buffer, size);
+        if(count < 0 && errno == EINTR){
+            continue;
+        }
+        return((s64)count);
+    }
+}
+
+static bool
+os_file_is_valid(OSFile file){
+    return(file.handle != 0);
+}
+
+static u64
+os_file_size(OSFile file){
+    u64 result = 0;
+    struct stat file_stat;
+    if(fstat(os_file_fd(file), &file_stat) == 0){
+        result = (u64)file_stat.st_size;
+    }
+    return(result);
+}
+
+// NOTE: The alignment O_DIRECT needs for offsets and buffers, 0 if the file can't do direct I/O. statx reports it
+// for regular files on kernels 6.1+, block devices report their logical sector size. st_blksize is only the
+// preferred I/O size, it is the last resort for kernels that can't tell us.
+static u32
+os_file_block_size(OSFile file){
+    u32 result = 0;
+    s32 fd = os_file_fd(file);
+#if defined(STATX_DIOALIGN)
+    struct statx file_statx;
+    if(statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &file_statx) == 0 && (file_statx.stx_mask & STATX_DIOALIGN)){
+        result = file_statx.stx_dio_offset_align;
+        if(file_statx.stx_dio_mem_align > result){
+            result = file_statx.stx_dio_mem_align;
+        }
+        return(result);
+    }
+#endif
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) == 0){
+        s32 sector_size = 0;
+        if(S_ISBLK(file_stat.st_mode) && ioctl(fd, BLKSSZGET, &sector_size) == 0){
+            result = (u32)sector_size;
+        }
+        else{
+            result = (u32)file_stat.st_blksize;
+        }
+    }
+    return(result);
+}
+
+static void
+os_file_close(OSFile file){
+    if(os_file_is_valid(file)){
+        close(os_file_fd(file));
+    }
+}
+
+///////////////////////////////
+// NOTE: Linux File Operations
+///////////////////////////////
+
+static bool
+os_file_delete(String8 dir, String8 file_name){
+    ScratchArena scratch = begin_scratch(0);
+    char* full_path = os_path_cstring(scratch.arena, dir, file_name);
+
+    bool result = (unlink(full_path) == 0);
+    end_scratch(scratch);
+    return(result);
+}
+
+static bool
+os_file_move(String8 source_dir, String8 source_file, String8 dest_dir, String8 dest_file){
+    ScratchArena scratch = begin_scratch(0);
+    char* source_path = os_path_cstring(scratch.arena, source_dir, source_file);
+    char* dest_path = os_path_cstring(scratch.arena, dest_dir, dest_file);
+
+    bool result = (rename(source_path, dest_path) == 0);
+    end_scratch(scratch);
+    return(result);
+}
+
+static bool
+os_dir_create(String8 dir, String8 new_dir){
+    ScratchArena scratch = begin_scratch(0);
+    char* dir_path = os_path_cstring(scratch.arena, dir, new_dir);
+
+    bool result = (mkdir(dir_path, 0755) == 0);
+    end_scratch(scratch);
+    return(result);
+}
+
+static bool
+os_dir_delete(String8 dir, String8 delete_dir){
+    ScratchArena scratch = begin_scratch(0);
+    char* dir_path = os_path_cstring(scratch.arena, dir, delete_dir);
+
+    bool result = (rmdir(dir_path) == 0);
+    end_scratch(scratch);
+    return(result);
+}
+
+#endif
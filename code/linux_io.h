@@ -0,0 +1,375 @@
+#if !defined(LINUX_IO_H)
+#define LINUX_IO_H
+
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "base_types.h"
+#include "base_memory.h"
+#include "linux_file.h"
+#include "linux_thread.h"
+
+///////////////////////////////
+// NOTE: Linux Async I/O
+///////////////////////////////
+// NOTE: Positional reads/writes against an OSFile. Submissions are only batched up until os_io_flush(),
+// completions are picked up with os_io_poll(). Uses io_uring, and falls back to a small pool of threads
+// doing pread/pwrite when io_uring isn't available (old kernels, seccomp'd containers) or can't do plain reads
+// and writes (before 5.6).
+//
+// usage:
+//     os_io_submit(io, IOOp_read, buffer, size, offset, tag); // returns false when the queue is full, poll first
+//     os_io_flush(io);
+//     u32 count = os_io_poll(io, completions, array_count(completions), true);
+
+typedef enum IOOp{
+    IOOp_read,
+    IOOp_write,
+} IOOp;
+
+typedef struct IOCompletion{
+    IOOp op;
+    u64 tag;
+    s64 result; // NOTE: bytes transferred, or < 0 on failure
+} IOCompletion;
+
+typedef struct IORequest{
+    IOOp op;
+    void* buffer;
+    u64 size;
+    u64 offset;
+    u64 tag;
+    s64 result;
+} IORequest;
+
+#define IO_THREAD_COUNT 4
+
+typedef struct IOQueue{
+    OSFile file;
+    u32 depth;
+    u32 in_flight; // NOTE: submitted and not yet returned by os_io_poll()
+    bool uring;
+
+    // NOTE: io_uring
+    s32 ring_fd;
+    u32 pending_submit;
+    void* sq_ring;
+    u64 sq_ring_size;
+    void* cq_ring;
+    u64 cq_ring_size;
+    struct io_uring_sqe* sqes;
+    u64 sqes_size;
+    u32* sq_tail;
+    u32* sq_mask;
+    u32* sq_array;
+    u32* cq_head;
+    u32* cq_tail;
+    u32* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    // NOTE: thread pool fallback. Both rings hold depth entries, in_flight <= depth keeps them from overflowing.
+    OSThread threads[IO_THREAD_COUNT];
+    OSMutex mutex;
+    OSCondition work_ready;
+    OSCondition work_done;
+    IORequest* requests;
+    u32 request_head;      // NOTE: next request a worker picks up
+    u32 request_published; // NOTE: requests before this were flushed and are visible to workers
+    u32 request_tail;
+    IORequest* completions;
+    u32 completion_head;
+    u32 completion_tail;
+    bool quit;
+} IOQueue;
+
+static s32
+io_uring_setup(u32 entries, struct io_uring_params* params){
+    return((s32)syscall(__NR_io_uring_setup, entries, params));
+}
+
+static s32
+io_uring_enter(s32 ring_fd, u32 to_submit, u32 min_complete, u32 flags){
+    return((s32)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, 0, 0));
+}
+
+static s32
+io_uring_register(s32 ring_fd, u32 opcode, void* arg, u32 count){
+    return((s32)syscall(__NR_io_uring_register, ring_fd, opcode, arg, count));
+}
+
+// NOTE: io_uring exists since 5.1 but IORING_OP_READ and IORING_OP_WRITE only since 5.6, an older ring takes
+// them and fails every one. The probe came with them, a kernel that doesn't know it doesn't have them either.
+static bool
+io_uring_supports_read_write(s32 ring_fd){
+    union{
+        struct io_uring_probe probe;
+        u8 bytes[sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op)];
+    } buffer;
+    mem_set(&buffer, 0, sizeof(buffer));
+    if(io_uring_register(ring_fd, IORING_REGISTER_PROBE, &buffer.probe, 256) < 0){
+        return(false);
+    }
+    struct io_uring_probe* probe = &buffer.probe;
+    u32 ops[] = {IORING_OP_READ, IORING_OP_WRITE};
+    for(u32 i=0; i < array_count(ops); ++i){
+        if(ops[i] >= probe->ops_len || !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED)){
+            return(false);
+        }
+    }
+    return(true);
+}
+
+static bool
+io_uring_init(IOQueue* io){
+    struct io_uring_params params = ZERO_INIT;
+    s32 ring_fd = io_uring_setup(io->depth, &params);
+    if(ring_fd < 0){
+        return(false);
+    }
+    if(!io_uring_supports_read_write(ring_fd)){
+        close(ring_fd);
+        return(false);
+    }
+
+    io->sq_ring_size = params.sq_off.array + (params.sq_entries * sizeof(u32));
+    io->cq_ring_size = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+    if(single_mmap){
+        io->sq_ring_size = MAX(io->sq_ring_size, io->cq_ring_size);
+        io->cq_ring_size = io->sq_ring_size;
+    }
+
+    io->sq_ring = mmap(0, io->sq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if(io->sq_ring == MAP_FAILED){
+        close(ring_fd);
+        return(false);
+    }
+    io->cq_ring = io->sq_ring;
+    if(!single_mmap){
+        io->cq_ring = mmap(0, io->cq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if(io->cq_ring == MAP_FAILED){
+            munmap(io->sq_ring, io->sq_ring_size);
+            close(ring_fd);
+            return(false);
+        }
+    }
+    io->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    io->sqes = (struct io_uring_sqe*)mmap(0, io->sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if(io->sqes == MAP_FAILED){
+        if(!single_mmap){
+            munmap(io->cq_ring, io->cq_ring_size);
+        }
+        munmap(io->sq_ring, io->sq_ring_size);
+        close(ring_fd);
+        return(false);
+    }
+
+    u8* sq = (u8*)io->sq_ring;
+    u8* cq = (u8*)io->cq_ring;
+    io->sq_tail = (u32*)(sq + params.sq_off.tail);
+    io->sq_mask = (u32*)(sq + params.sq_off.ring_mask);
+    io->sq_array = (u32*)(sq + params.sq_off.array);
+    io->cq_head = (u32*)(cq + params.cq_off.head);
+    io->cq_tail = (u32*)(cq + params.cq_off.tail);
+    io->cq_mask = (u32*)(cq + params.cq_off.ring_mask);
+    io->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    io->ring_fd = ring_fd;
+    io->depth = MIN(io->depth, params.sq_entries);
+    io->uring = true;
+    return(true);
+}
+
+static void
+io_thread_proc(void* data){
+    IOQueue* io = (IOQueue*)data;
+    os_mutex_lock(&io->mutex);
+    while(true){
+        while(!io->quit && io->request_head == io->request_published){
+            os_condition_wait(&io->work_ready, &io->mutex);
+        }
+        if(io->quit){
+            break;
+        }
+        IORequest request = io->requests[io->request_head % io->depth];
+        io->request_head += 1;
+        os_mutex_unlock(&io->mutex);
+
+        s32 fd = os_file_fd(io->file);
+        u64 done = 0;
+        while(done < request.size){
+            ssize_t count;
+            if(request.op == IOOp_read){
+                count = pread(fd, (u8*)request.buffer + done, request.size - done, request.offset + done);
+            }
+            else{
+                count = pwrite(fd, (u8*)request.buffer + done, request.size - done, request.offset + done);
+            }
+            if(count <= 0){
+                break;
+            }
+            done += count;
+        }
+        request.result = (done == request.size) ? (s64)done : -1;
+
+        os_mutex_lock(&io->mutex);
+        io->completions[io->completion_tail % io->depth] = request;
+        io->completion_tail += 1;
+        os_condition_signal(&io->work_done);
+    }
+    os_mutex_unlock(&io->mutex);
+}
+
+static IOQueue*
+os_io_create(Arena* arena, OSFile file, u32 depth){
+    IOQueue* io = push_struct(arena, IOQueue);
+    mem_set(io, 0, sizeof(IOQueue));
+    io->file = file;
+    io->depth = depth;
+
+    if(!io_uring_init(io)){
+        io->requests = push_array(arena, IORequest, depth);
+        io->completions = push_array(arena, IORequest, depth);
+        os_mutex_init(&io->mutex);
+        os_condition_init(&io->work_ready);
+        os_condition_init(&io->work_done);
+        for(u32 i=0; i < IO_THREAD_COUNT; ++i){
+            os_thread_start(io->threads + i, io_thread_proc, io);
+        }
+    }
+    return(io);
+}
+
+static void
+os_io_destroy(IOQueue* io){
+    if(io->uring){
+        munmap(io->sqes, io->sqes_size);
+        if(io->cq_ring != io->sq_ring){
+            munmap(io->cq_ring, io->cq_ring_size);
+        }
+        munmap(io->sq_ring, io->sq_ring_size);
+        close(io->ring_fd);
+    }
+    else{
+        os_mutex_lock(&io->mutex);
+        io->quit = true;
+        os_condition_broadcast(&io->work_ready);
+        os_mutex_unlock(&io->mutex);
+        for(u32 i=0; i < IO_THREAD_COUNT; ++i){
+            os_thread_join(io->threads + i);
+        }
+    }
+}
+
+static bool
+os_io_submit(IOQueue* io, IOOp op, void* buffer, u64 size, u64 offset, u64 tag){
+    if(io->in_flight >= io->depth){
+        return(false);
+    }
+    io->in_flight += 1;
+
+    if(io->uring){
+        // NOTE: Only this thread writes the sq tail, the kernel only reads it.
+        u32 tail = *io->sq_tail;
+        u32 index = tail & *io->sq_mask;
+        struct io_uring_sqe* sqe = io->sqes + index;
+        mem_set(sqe, 0, sizeof(*sqe));
+        sqe->opcode = (op == IOOp_read) ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = os_file_fd(io->file);
+        sqe->addr = (u64)buffer;
+        sqe->len = (u32)size;
+        sqe->off = offset;
+        sqe->user_data = (tag << 1) | (u64)op;
+        io->sq_array[index] = index;
+        __atomic_store_n(io->sq_tail, tail + 1, __ATOMIC_RELEASE);
+        io->pending_submit += 1;
+    }
+    else{
+        // NOTE: Only the submitting thread touches request_tail, workers can't see it until the flush.
+        IORequest* request = io->requests + (io->request_tail % io->depth);
+        request->op = op;
+        request->buffer = buffer;
+        request->size = size;
+        request->offset = offset;
+        request->tag = tag;
+        request->result = 0;
+        io->request_tail += 1;
+    }
+    return(true);
+}
+
+static void
+os_io_flush(IOQueue* io){
+    if(io->uring){
+        while(io->pending_submit > 0){
+            s32 submitted = io_uring_enter(io->ring_fd, io->pending_submit, 0, 0);
+            if(submitted < 0){
+                if(errno == EINTR || errno == EAGAIN || errno == EBUSY){
+                    continue;
+                }
+                print("os_io_flush: io_uring_enter failed - error: %d\n", errno);
+                exit(EXIT_FAILURE);
+            }
+            io->pending_submit -= submitted;
+        }
+    }
+    else{
+        os_mutex_lock(&io->mutex);
+        if(io->request_published != io->request_tail){
+            io->request_published = io->request_tail;
+            os_condition_broadcast(&io->work_ready);
+        }
+        os_mutex_unlock(&io->mutex);
+    }
+}
+
+static u32
+os_io_poll(IOQueue* io, IOCompletion* completions, u32 max_count, bool wait){
+    // NOTE: Flushes anything still batched, so waiting on a request that was never submitted can't hang.
+    os_io_flush(io);
+    wait = wait && (io->in_flight > 0);
+
+    u32 count = 0;
+    if(io->uring){
+        while(true){
+            u32 head = *io->cq_head;
+            u32 tail = __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE);
+            while(head != tail && count < max_count){
+                struct io_uring_cqe* cqe = io->cqes + (head & *io->cq_mask);
+                IOCompletion* completion = completions + count++;
+                completion->op = (IOOp)(cqe->user_data & 1);
+                completion->tag = cqe->user_data >> 1;
+                completion->result = cqe->res;
+                head += 1;
+            }
+            __atomic_store_n(io->cq_head, head, __ATOMIC_RELEASE);
+
+            if(count > 0 || !wait){
+                break;
+            }
+            s32 entered = io_uring_enter(io->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+            if(entered < 0 && errno != EINTR){
+                print("os_io_poll: io_uring_enter failed - error: %d\n", errno);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    else{
+        os_mutex_lock(&io->mutex);
+        while(wait && io->completion_head == io->completion_tail){
+            os_condition_wait(&io->work_done, &io->mutex);
+        }
+        while(io->completion_head != io->completion_tail && count < max_count){
+            IORequest* request = io->completions + (io->completion_head % io->depth);
+            IOCompletion* completion = completions + count++;
+            completion->op = request->op;
+            completion->tag = request->tag;
+            completion->result = request->result;
+            io->completion_head += 1;
+        }
+        os_mutex_unlock(&io->mutex);
+    }
+
+    io->in_flight -= count;
+    return(count);
+}
+
+#endif
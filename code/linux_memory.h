@@ -0,0 +1,70 @@
+#if !defined(LINUX_MEMORY_H)
+#define LINUX_MEMORY_H
+
+#include <sys/mman.h>
+#include "base_types.h"
+#include "base_memory.h"
+#include "base_string.h"
+
+///////////////////////////////
+// NOTE: Linux Memory
+///////////////////////////////
+
+static void* os_virtual_alloc(u64 size){
+    // NOTE: anonymous mappings are zero initialized, same as VirtualAlloc()
+    void* result = mmap(0, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(result == MAP_FAILED){
+        result = 0;
+    }
+    return(result);
+}
+
+static bool os_virtual_free(void* base, u64 size){
+    bool result = false;
+    if(base){
+        result = (munmap(base, size) == 0);
+    }
+    return(result);
+}
+
+static void* os_reserve(u64 size){
+    // NOTE: PROT_NONE + MAP_NORESERVE only claims address space, os_commit() makes pages usable.
+    void* result = mmap(0, size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if(result == MAP_FAILED){
+        result = 0;
+    }
+    return(result);
+}
+
+static bool os_commit(void* base, u64 size){
+    // NOTE: Pages are zero filled on first touch.
+    bool result = (mprotect(base, size, PROT_READ|PROT_WRITE) == 0);
+    return(result);
+}
+
+static void os_decommit(void* base, u64 size){
+    // NOTE: MADV_DONTNEED drops the backing pages, they read back as zero if committed again.
+    madvise(base, size, MADV_DONTNEED);
+    mprotect(base, size, PROT_NONE);
+}
+
+static void os_release(void* base, u64 size){
+    munmap(base, size);
+}
+
+static bool os_advise_huge_pages(void* base, u64 size){
+    // NOTE: Only a hint, khugepaged may or may not back the range depending on
+    // /sys/kernel/mm/transparent_hugepage/enabled. base and size should be huge page aligned.
+    bool result = (madvise(base, size, MADV_HUGEPAGE) == 0);
+    return(result);
+}
+
+static Arena* os_alloc_arena(size_t size){
+    // NOTE: Fully committed up front, grows by chaining more virtual blocks like any other arena.
+    void* memory = os_virtual_alloc((size + sizeof(Arena)));
+    Arena* result = (Arena*)memory;
+    arena_init_block(result, (u8*)memory + sizeof(Arena), size, size, ArenaFlag_virtual);
+    return(result);
+}
+
+#endif
@@ -0,0 +1,234 @@
+#if !defined(LINUX_NET_H)
+#define LINUX_NET_H
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include "base_types.h"
+#include "base_memory.h"
+#include "base_string.h"
+
+///////////////////////////////
+// NOTE: Linux Local Sockets
+///////////////////////////////
+// NOTE: Unix domain stream sockets, all non blocking, and an epoll poller to wait on many of them at once.
+// Server mode is Linux only, there is no win32 counterpart.
+//
+// usage:
+//     OSSocket listener = os_socket_listen_local(str8_literal("/tmp/db.sock"));
+//     OSPoller poller = os_poller_create();
+//     os_poller_add(poller, listener, tag, false);
+//     u32 count = os_poller_wait(poller, events, array_count(events), timeout_ms);
+
+typedef struct OSSocket{
+    u64 handle; // NOTE: fd + 1, 0 is invalid
+} OSSocket;
+
+#define OS_SOCKET_WOULD_BLOCK (-1)
+
+static s32
+os_socket_fd(OSSocket socket){
+    return((s32)socket.handle - 1);
+}
+
+static bool
+os_socket_is_valid(OSSocket socket){
+    return(socket.handle != 0);
+}
+
+// NOTE: Removes a socket file left behind by an earlier run before binding, a path that is in use by a live
+// server gets taken over.
+static OSSocket
+os_socket_listen_local(String8 path){
+    OSSocket result = ZERO_INIT;
+    struct sockaddr_un address = ZERO_INIT;
+    address.sun_family = AF_UNIX;
+    if(path.size >= sizeof(address.sun_path)){
+        print("os_socket_listen_local: path is longer than %d bytes\n", (s32)sizeof(address.sun_path) - 1);
+        return(result);
+    }
+    mem_copy(address.sun_path, path.str, path.size);
+    address.sun_path[path.size] = 0;
+    unlink(address.sun_path);
+
+    s32 fd = socket(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0);
+    if(fd < 0){
+        print("os_socket_listen_local: failed to create socket - error: %d\n", errno);
+        return(result);
+    }
+    if(bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0){
+        print("os_socket_listen_local: failed to listen on '%s' - error: %d\n", address.sun_path, errno);
+        close(fd);
+        return(result);
+    }
+    result.handle = (u64)fd + 1;
+    return(result);
+}
+
+// NOTE: Connects to a server's socket file, invalid when nothing is listening there.
+static OSSocket
+os_socket_connect_local(String8 path){
+    OSSocket result = ZERO_INIT;
+    struct sockaddr_un address = ZERO_INIT;
+    address.sun_family = AF_UNIX;
+    if(path.size >= sizeof(address.sun_path)){
+        print("os_socket_connect_local: path is longer than %d bytes\n", (s32)sizeof(address.sun_path) - 1);
+        return(result);
+    }
+    mem_copy(address.sun_path, path.str, path.size);
+    address.sun_path[path.size] = 0;
+
+    s32 fd = socket(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0);
+    if(fd < 0){
+        print("os_socket_connect_local: failed to create socket - error: %d\n", errno);
+        return(result);
+    }
+    if(connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0){
+        print("os_socket_connect_local: failed to connect to '%s' - error: %d\n", address.sun_path, errno);
+        close(fd);
+        return(result);
+    }
+    result.handle = (u64)fd + 1;
+    return(result);
+}
+
+// NOTE: Invalid when no connection is pending.
+static OSSocket
+os_socket_accept(OSSocket listener){
+    OSSocket result = ZERO_INIT;
+    s32 fd = accept4(os_socket_fd(listener), 0, 0, SOCK_NONBLOCK|SOCK_CLOEXEC);
+    if(fd >= 0){
+        result.handle = (u64)fd + 1;
+    }
+    return(result);
+}
+
+// NOTE: Returns bytes read, 0 once the peer closed or the socket failed, OS_SOCKET_WOULD_BLOCK when nothing is
+// buffered right now.
+static s64
+os_socket_read(OSSocket socket, void* buffer, u64 size){
+    for(;;){
+        ssize_t count = recv(os_socket_fd(socket), buffer, size, 0);
+        if(count >= 0){
+            return((s64)count);
+        }
+        if(errno == EINTR){
+            continue;
+        }
+        if(errno == EAGAIN || errno == EWOULDBLOCK){
+            return(OS_SOCKET_WOULD_BLOCK);
+        }
+        return(0);
+    }
+}
+
+// NOTE: Writes all of data, waiting for room when the socket buffer is full. False once the peer is gone.
+static bool
+os_socket_write(OSSocket socket, void const* data, u64 size){
+    s32 fd = os_socket_fd(socket);
+    u8 const* ptr = (u8 const*)data;
+    while(size > 0){
+        ssize_t written = send(fd, ptr, size, MSG_NOSIGNAL);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK){
+                struct pollfd wait = {fd, POLLOUT, 0};
+                poll(&wait, 1, -1);
+                continue;
+            }
+            return(false);
+        }
+        ptr += written;
+        size -= (u64)written;
+    }
+    return(true);
+}
+
+// NOTE: Tells the peer nothing more is coming, its reads see the end once they've had everything sent before.
+static void
+os_socket_close_write(OSSocket socket){
+    shutdown(os_socket_fd(socket), SHUT_WR);
+}
+
+// NOTE: Waits until the socket has something to read or the peer closed, timeout_ms < 0 waits forever. False on
+// timeout.
+static bool
+os_socket_wait_readable(OSSocket socket, s32 timeout_ms){
+    struct pollfd wait = {os_socket_fd(socket), POLLIN, 0};
+    return(poll(&wait, 1, timeout_ms) > 0);
+}
+
+static void
+os_socket_close(OSSocket socket){
+    if(os_socket_is_valid(socket)){
+        close(os_socket_fd(socket));
+    }
+}
+
+///////////////////////////////
+// NOTE: Linux Poller
+///////////////////////////////
+// NOTE: A socket added with oneshot is reported once and then ignored until os_poller_rearm(), so whichever
+// thread picks up the event owns the socket until it rearms it.
+
+typedef struct OSPoller{
+    s32 fd;
+} OSPoller;
+
+typedef struct OSPollEvent{
+    u64 tag; // NOTE: readable or hung up, a read tells which
+} OSPollEvent;
+
+static OSPoller
+os_poller_create(void){
+    OSPoller result;
+    result.fd = epoll_create1(EPOLL_CLOEXEC);
+    if(result.fd < 0){
+        print("os_poller_create: epoll_create1 failed - error: %d\n", errno);
+        exit(EXIT_FAILURE);
+    }
+    return(result);
+}
+
+static void
+os_poller_destroy(OSPoller poller){
+    close(poller.fd);
+}
+
+static bool
+os_poller_add(OSPoller poller, OSSocket socket, u64 tag, bool oneshot){
+    struct epoll_event event = ZERO_INIT;
+    event.events = EPOLLIN|EPOLLRDHUP;
+    if(oneshot){
+        event.events |= EPOLLONESHOT;
+    }
+    event.data.u64 = tag;
+    return(epoll_ctl(poller.fd, EPOLL_CTL_ADD, os_socket_fd(socket), &event) == 0);
+}
+
+static bool
+os_poller_rearm(OSPoller poller, OSSocket socket, u64 tag){
+    struct epoll_event event = ZERO_INIT;
+    event.events = EPOLLIN|EPOLLRDHUP|EPOLLONESHOT;
+    event.data.u64 = tag;
+    return(epoll_ctl(poller.fd, EPOLL_CTL_MOD, os_socket_fd(socket), &event) == 0);
+}
+
+// NOTE: Returns 0 on timeout or when a signal cut the wait short. timeout_ms < 0 waits forever.
+static u32
+os_poller_wait(OSPoller poller, OSPollEvent* events, u32 max_count, s32 timeout_ms){
+    struct epoll_event ready[64];
+    s32 count = epoll_wait(poller.fd, ready, (s32)MIN(max_count, array_count(ready)), timeout_ms);
+    if(count < 0){
+        return(0);
+    }
+    for(s32 i=0; i < count; ++i){
+        events[i].tag = ready[i].data.u64;
+    }
+    return((u32)count);
+}
+
+#endif
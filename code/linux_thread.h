@@ -0,0 +1,112 @@
+#if !defined(LINUX_THREAD_H)
+#define LINUX_THREAD_H
+
+#include <pthread.h>
+#include <signal.h>
+#include "base_types.h"
+
+///////////////////////////////
+// NOTE: Linux Threads
+///////////////////////////////
+// NOTE: Threads, mutexes and condition variables. Same interface as win32_thread.h.
+//
+// usage:
+//     OSThread thread;
+//     os_thread_start(&thread, proc, data); // thread must stay put until os_thread_join()
+//     os_thread_join(&thread);
+
+typedef void OSThreadProc(void* data);
+
+typedef struct OSThread{
+    pthread_t handle;
+    OSThreadProc* proc;
+    void* data;
+} OSThread;
+
+typedef struct OSMutex{
+    pthread_mutex_t handle;
+} OSMutex;
+
+typedef struct OSCondition{
+    pthread_cond_t handle;
+} OSCondition;
+
+static void*
+os_thread_entry(void* data){
+    OSThread* thread = (OSThread*)data;
+    thread->proc(thread->data);
+    return(0);
+}
+
+static bool
+os_thread_start(OSThread* thread, OSThreadProc* proc, void* data){
+    thread->proc = proc;
+    thread->data = data;
+    return(pthread_create(&thread->handle, 0, os_thread_entry, thread) == 0);
+}
+
+static void
+os_thread_join(OSThread* thread){
+    pthread_join(thread->handle, 0);
+}
+
+static void
+os_mutex_init(OSMutex* mutex){
+    pthread_mutex_init(&mutex->handle, 0);
+}
+
+static void
+os_mutex_lock(OSMutex* mutex){
+    pthread_mutex_lock(&mutex->handle);
+}
+
+static void
+os_mutex_unlock(OSMutex* mutex){
+    pthread_mutex_unlock(&mutex->handle);
+}
+
+static void
+os_condition_init(OSCondition* condition){
+    pthread_cond_init(&condition->handle, 0);
+}
+
+static void
+os_condition_wait(OSCondition* condition, OSMutex* mutex){
+    pthread_cond_wait(&condition->handle, &mutex->handle);
+}
+
+static void
+os_condition_signal(OSCondition* condition){
+    pthread_cond_signal(&condition->handle);
+}
+
+static void
+os_condition_broadcast(OSCondition* condition){
+    pthread_cond_broadcast(&condition->handle);
+}
+
+///////////////////////////////
+// NOTE: Linux Interrupt
+///////////////////////////////
+// NOTE: ctrl-c and SIGTERM call handler instead of killing the process. No SA_RESTART, so a blocking wait on the
+// main thread returns early and the caller gets to look at whatever the handler set.
+
+typedef void OSInterruptFunc(void);
+global OSInterruptFunc* os_interrupt_func;
+
+static void
+os_interrupt_signal(s32){
+    os_interrupt_func();
+}
+
+static void
+os_set_interrupt_handler(OSInterruptFunc* handler){
+    os_interrupt_func = handler;
+    struct sigaction action = ZERO_INIT;
+    action.sa_handler = os_interrupt_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, 0);
+    sigaction(SIGTERM, &action, 0);
+}
+
+#endif
@@ -0,0 +1,19 @@
+#if !defined(LINUX_TIME_H)
+#define LINUX_TIME_H
+
+#include <time.h>
+#include "base_types.h"
+
+///////////////////////////////
+// NOTE: Linux Clock
+///////////////////////////////
+// NOTE: Monotonic wall clock, for timing things that don't fit in a cpu timer difference and for calibrating it.
+
+static u64
+os_time_ns(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return((u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec);
+}
+
+#endif
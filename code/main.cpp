@@ -1,13 +1,29 @@
 #define _CRT_SECURE_NO_DEPRECATE 1
 
 #include "base_inc.h"
+#if OS_WIN
 #include "win32_base_inc.h"
-
-global Arena* pm = alloc_arena(MB(4));
-global Arena* tm = alloc_arena(MB(1));
+#elif OS_LINUX
+#include "linux_base_inc.h"
+#endif
+
+// NOTE: Reserved, not committed. pm lives for the whole run, tm is reset after every statement and hands
+// back whatever a big statement committed past its first granule.
+global Arena* pm = arena_reserve(GB(1), 0);
+global Arena* tm = arena_reserve(GB(1), ArenaFlag_decommit_on_reset);
 global String8 dir = os_get_cwd(pm);
+#if OS_WIN
 global String8 filename = str8_literal("\\data\\mydb.db");
+#else
+global String8 filename = str8_literal("/data/mydb.db");
+#endif
 global bool running = true;
+global bool direct_io = false; // NOTE: --direct, page I/O bypasses the OS page cache
+global bool huge_pages = false; // NOTE: --huge-pages, back the frame pool with transparent huge pages
+#if PROFILER
+global String8 trace_path; // NOTE: --trace <path>, profiler blocks are written there as a Chrome trace on exit
+global u64 const TRACE_MAX_EVENTS = MILLION(1);
+#endif
 
 global u32 const ID_SIZE = sizeof(s32);
 global u32 const USERNAME_SIZE = 32;
@@ -22,11 +38,12 @@ global u32 ID_OFFSET = 0;
 global u32 USERNAME_OFFSET = ID_OFFSET + ID_SIZE;
 global u32 EMAIL_OFFSET = USERNAME_OFFSET + USERNAME_SIZE;
 global u32 ROW_SIZE = sizeof(Row);
-global u32 PAGE_SIZE = 900;
-global u32 INTERNAL_NODE_MAX_CELLS = 3;
-global u32 const TABLE_PAGES = 100;
+global u32 PAGE_SIZE = 4096; // NOTE: multiple of the device block size, direct I/O depends on it
+global u32 const FRAME_COUNT = 1024; // NOTE: buffer pool size in pages
+global u32 const FRAME_BUCKET_COUNT = 2048; // NOTE: power of 2
+global u32 const LEAF_PREFETCH_DISTANCE = 2;
+global u32 const PAGE_IO_DEPTH = 32;
 global u32 ROWS_PER_PAGE = PAGE_SIZE / ROW_SIZE;
-global u32 TABLE_ROWS = ROWS_PER_PAGE * TABLE_PAGES;
 
 
 // NOTE: Here we are defining the layout of our data (format).
@@ -60,9 +77,25 @@ global u32 LEAF_NODE_KEY_SIZE = sizeof(u32);
 global u32 LEAF_NODE_KEY_OFFSET = 0;
 global u32 LEAF_NODE_VALUE_SIZE = ROW_SIZE;
 global u32 LEAF_NODE_VALUE_OFFSET = LEAF_NODE_KEY_OFFSET + LEAF_NODE_KEY_SIZE;
-global u32 LEAF_NODE_CELL_SIZE = LEAF_NODE_KEY_SIZE + LEAF_NODE_VALUE_SIZE;
 global u32 LEAF_NODE_SPACE_FOR_CELLS = PAGE_SIZE - LEAF_NODE_HEADER_SIZE;
+
+// NOTE: PAX Leaf Node Body Layout. Instead of whole cells, every column gets its own minipage, so a scan that only
+//       needs some of the columns only pulls those into cache. The key doubles as the id column.
+//          [(key)(key)(key)...][(username)(username)(username)...][(email)(email)(email)...]
+//                 ^                          ^                                ^
+//           keys minipage           usernames minipage                  emails minipage
+#if !defined(LEAF_NODE_PAX)
+# define LEAF_NODE_PAX 0 // NOTE: build with -DLEAF_NODE_PAX=1 for the PAX layout
+#endif
+#if LEAF_NODE_PAX
+global u32 LEAF_NODE_CELL_SIZE = LEAF_NODE_KEY_SIZE + USERNAME_SIZE + EMAIL_SIZE;
+#else
+global u32 LEAF_NODE_CELL_SIZE = LEAF_NODE_KEY_SIZE + LEAF_NODE_VALUE_SIZE;
+#endif
 global u32 LEAF_NODE_MAX_CELLS = LEAF_NODE_SPACE_FOR_CELLS / LEAF_NODE_CELL_SIZE;
+global u32 LEAF_NODE_KEYS_OFFSET = LEAF_NODE_HEADER_SIZE;
+global u32 LEAF_NODE_USERNAMES_OFFSET = LEAF_NODE_KEYS_OFFSET + (LEAF_NODE_MAX_CELLS * LEAF_NODE_KEY_SIZE);
+global u32 LEAF_NODE_EMAILS_OFFSET = LEAF_NODE_USERNAMES_OFFSET + (LEAF_NODE_MAX_CELLS * USERNAME_SIZE);
 
 global u32 LEAF_NODE_RIGHT_SPLIT_COUNT = (LEAF_NODE_MAX_CELLS + 1) / 2;
 global u32 LEAF_NODE_LEFT_SPLIT_COUNT = (LEAF_NODE_MAX_CELLS + 1) - LEAF_NODE_RIGHT_SPLIT_COUNT;
@@ -74,10 +107,37 @@ global u32 INTERNAL_NODE_RIGHT_CHILD_SIZE = sizeof(u32);
 global u32 INTERNAL_NODE_RIGHT_CHILD_OFFSET = INTERNAL_NODE_NUM_KEYS_OFFSET + INTERNAL_NODE_NUM_KEYS_SIZE;
 global u32 INTERNAL_NODE_HEADER_SIZE = COMMON_NODE_HEADER_SIZE + INTERNAL_NODE_NUM_KEYS_SIZE + INTERNAL_NODE_RIGHT_CHILD_SIZE;
 
-// NOTE: Internal node body layout
+// NOTE: Internal node body layout. Keys are stored contiguously, followed by the child pointers, so a search only
+//       walks the key array and can compare several keys at once.
+//          [(key)(key)(key)...][(child)(child)(child)...]
+//                 ^                        ^
+//       INTERNAL_NODE_MAX_CELLS keys   INTERNAL_NODE_MAX_CELLS children (right child lives in the header)
 global u32 INTERNAL_NODE_KEY_SIZE = sizeof(u32);
 global u32 INTERNAL_NODE_CHILD_SIZE = sizeof(u32);
 global u32 INTERNAL_NODE_CELL_SIZE = INTERNAL_NODE_KEY_SIZE + INTERNAL_NODE_CHILD_SIZE;
+global u32 INTERNAL_NODE_SPACE_FOR_CELLS = PAGE_SIZE - INTERNAL_NODE_HEADER_SIZE;
+global u32 INTERNAL_NODE_MAX_CELLS = INTERNAL_NODE_SPACE_FOR_CELLS / INTERNAL_NODE_CELL_SIZE;
+global u32 INTERNAL_NODE_KEYS_OFFSET = INTERNAL_NODE_HEADER_SIZE;
+global u32 INTERNAL_NODE_CHILDREN_OFFSET = INTERNAL_NODE_KEYS_OFFSET + (INTERNAL_NODE_MAX_CELLS * INTERNAL_NODE_KEY_SIZE);
+
+// NOTE: Once a binary search narrows the keys down to this many, the rest are counted with SIMD compares.
+#define INTERNAL_NODE_SEARCH_WINDOW 16
+
+// NOTE: File header layout. Page 0 of every db file is the header, the tree starts at page 1. db_open refuses a
+//       file whose header doesn't match this build, the page layout depends on PAGE_SIZE and LEAF_NODE_PAX.
+//          [(magic)(version)(page_size)(leaf_layout)]
+//       Bump FILE_FORMAT_VERSION whenever the layout of any page changes.
+global u8 const FILE_MAGIC[8] = {'m', 'y', 'd', 'b', 'f', 'i', 'l', 'e'};
+global u32 const FILE_FORMAT_VERSION = 1;
+global u32 FILE_MAGIC_SIZE = sizeof(FILE_MAGIC);
+global u32 FILE_MAGIC_OFFSET = 0;
+global u32 FILE_VERSION_SIZE = sizeof(u32);
+global u32 FILE_VERSION_OFFSET = FILE_MAGIC_OFFSET + FILE_MAGIC_SIZE;
+global u32 FILE_PAGE_SIZE_SIZE = sizeof(u32);
+global u32 FILE_PAGE_SIZE_OFFSET = FILE_VERSION_OFFSET + FILE_VERSION_SIZE;
+global u32 FILE_LEAF_LAYOUT_OFFSET = FILE_PAGE_SIZE_OFFSET + FILE_PAGE_SIZE_SIZE;
+global u32 const FILE_HEADER_PAGE_NUM = 0;
+global u32 const ROOT_PAGE_NUM = 1;
 
 
 typedef enum NodeType{
@@ -109,7 +169,7 @@ set_node_type(void* node, NodeType type){
 
 static bool
 is_node_root(void* node){
-    u8 result = *(u8*)node + IS_ROOT_OFFSET;
+    u8 result = *((u8*)node + IS_ROOT_OFFSET);
     return((bool)result);
 }
 
@@ -124,8 +184,13 @@ internal_node_right_child(void* node){
 }
 
 static u32*
-internal_node_cell(void* node, u32 cell_num){
-    return((u32*)((u8*)node + INTERNAL_NODE_HEADER_SIZE + (cell_num * INTERNAL_NODE_CELL_SIZE)));
+internal_node_keys(void* node){
+    return((u32*)((u8*)node + INTERNAL_NODE_KEYS_OFFSET));
+}
+
+static u32*
+internal_node_children(void* node){
+    return((u32*)((u8*)node + INTERNAL_NODE_CHILDREN_OFFSET));
 }
 
 static u32*
@@ -139,13 +204,13 @@ internal_node_child(void* node, u32 child_num){
         return(internal_node_right_child(node));
     }
     else{
-        return(internal_node_cell(node, child_num));
+        return(internal_node_children(node) + child_num);
     }
 }
 
 static u32*
 internal_node_key(void* node, u32 key_num){
-    return((u32*)(((u8*)((void*)internal_node_cell(node, key_num))) + INTERNAL_NODE_CHILD_SIZE));
+    return(internal_node_keys(node) + key_num);
 }
 
 static void
@@ -166,6 +231,38 @@ leaf_node_num_cells(void* node){
     return(result);
 }
 
+#if LEAF_NODE_PAX
+static u32*
+leaf_node_key(void* node, u32 cell_num){
+    u32* result = (u32*)((u8*)node + LEAF_NODE_KEYS_OFFSET) + cell_num;
+    return(result);
+}
+
+static u32*
+leaf_node_id(void* node, u32 cell_num){
+    return(leaf_node_key(node, cell_num));
+}
+
+static char*
+leaf_node_username(void* node, u32 cell_num){
+    char* result = (char*)node + LEAF_NODE_USERNAMES_OFFSET + (cell_num * USERNAME_SIZE);
+    return(result);
+}
+
+static char*
+leaf_node_email(void* node, u32 cell_num){
+    char* result = (char*)node + LEAF_NODE_EMAILS_OFFSET + (cell_num * EMAIL_SIZE);
+    return(result);
+}
+
+static void
+leaf_node_move_cells(void* dest_node, u32 dest_cell_num, void* source_node, u32 source_cell_num, u32 count){
+    // NOTE: Each column is moved within its own minipage. memmove, source and dest can overlap when shifting.
+    memmove(leaf_node_key(dest_node, dest_cell_num), leaf_node_key(source_node, source_cell_num), count * LEAF_NODE_KEY_SIZE);
+    memmove(leaf_node_username(dest_node, dest_cell_num), leaf_node_username(source_node, source_cell_num), count * USERNAME_SIZE);
+    memmove(leaf_node_email(dest_node, dest_cell_num), leaf_node_email(source_node, source_cell_num), count * EMAIL_SIZE);
+}
+#else
 static void*
 leaf_node_cell(void* node, u32 cell_num){
     void* result = (u8*)node + LEAF_NODE_HEADER_SIZE + (cell_num * LEAF_NODE_CELL_SIZE);
@@ -184,6 +281,31 @@ leaf_node_value(void* node, u32 cell_num){
     return(result);
 }
 
+static u32*
+leaf_node_id(void* node, u32 cell_num){
+    u32* result = (u32*)((u8*)leaf_node_value(node, cell_num) + ID_OFFSET);
+    return(result);
+}
+
+static char*
+leaf_node_username(void* node, u32 cell_num){
+    char* result = (char*)leaf_node_value(node, cell_num) + USERNAME_OFFSET;
+    return(result);
+}
+
+static char*
+leaf_node_email(void* node, u32 cell_num){
+    char* result = (char*)leaf_node_value(node, cell_num) + EMAIL_OFFSET;
+    return(result);
+}
+
+static void
+leaf_node_move_cells(void* dest_node, u32 dest_cell_num, void* source_node, u32 source_cell_num, u32 count){
+    // NOTE: memmove, source and dest can overlap when shifting cells within a node.
+    memmove(leaf_node_cell(dest_node, dest_cell_num), leaf_node_cell(source_node, source_cell_num), count * LEAF_NODE_CELL_SIZE);
+}
+#endif
+
 static u32
 get_node_max_key(void* node){
     switch(get_node_type(node)){
@@ -233,95 +355,427 @@ typedef enum StatementType{
     StatementType_select,
 } StatementType;
 
+typedef enum Column{
+    Column_id       = (1 << 0),
+    Column_username = (1 << 1),
+    Column_email    = (1 << 2),
+    Column_all      = (Column_id|Column_username|Column_email),
+} Column;
+
 typedef enum ExecuteResult{
     ExecuteResult_success,
     ExecuteResult_table_full,
     ExecuteResult_duplicate_key,
+    ExecuteResult_unbound_parameter,
+    ExecuteResult_io_error, // NOTE: a page read or write failed, see Table::io_failed
 } ExecuteResult;
 
+// NOTE: A prepared statement. `insert ? ? ?` or `select where id >= ? limit ?` leaves the marked values as
+// parameters, the statement is parsed once and then rebound with statement_bind_* and executed as often as
+// needed without touching the text again.
+#define STATEMENT_MAX_PARAMS 3
+
+// NOTE: What a ? stands for. Row fields use their Column flag.
+typedef enum ParamTarget{
+    ParamTarget_id       = Column_id,
+    ParamTarget_username = Column_username,
+    ParamTarget_email    = Column_email,
+    ParamTarget_filter   = (1 << 3),
+    ParamTarget_limit    = (1 << 4),
+} ParamTarget;
+
+typedef enum CompareOp{
+    CompareOp_none,
+    CompareOp_eq,
+    CompareOp_ne,
+    CompareOp_lt,
+    CompareOp_le,
+    CompareOp_gt,
+    CompareOp_ge,
+    CompareOp_like, // NOTE: text only, a leading and/or trailing % matches anything, a % anywhere else is literal
+} CompareOp;
+
+// NOTE: One `<column> <op> <value>` of a where clause. Text values are copied in, the statement doesn't keep the
+// input. A like pattern is kept as written, % included.
+typedef struct Predicate{
+    u32 column;
+    CompareOp op;
+    u32 integer;
+    u32 text_size;
+    char text[EMAIL_SIZE];
+} Predicate;
+
+// NOTE: select ... where <predicate> [and <predicate>]
+#define FILTER_MAX_TERMS 2
+
+typedef struct Filter{
+    u32 count;
+    Predicate terms[FILTER_MAX_TERMS];
+} Filter;
+
 typedef struct Statement{
     StatementType type;
     Row row;
+    u32 columns; // NOTE: Column flags, the projection of a select
+    Filter filter;
+    u32 limit; // NOTE: u32_max for no limit
+    u32 param_count;
+    u32 param_targets[STATEMENT_MAX_PARAMS]; // NOTE: the ParamTarget each ? stands for, in order
+    u32 param_terms[STATEMENT_MAX_PARAMS]; // NOTE: the filter term a ParamTarget_filter binds
+    u32 bound; // NOTE: bit per parameter, set once it has a value
     size_t size; // TODO: get rid of
 } Statement;
 
+// NOTE: Where select rows go. Rows are formatted straight into the sink's Writer and only reach stdout when its
+// buffer fills or the statement finishes.
+typedef enum ResultFormat{
+    ResultFormat_text,   // NOTE: (1, name, email)
+    ResultFormat_csv,    // NOTE: header line, then RFC 4180 rows
+    ResultFormat_binary, // NOTE: per row, per selected column: u32 id, or u32 length + bytes, little endian
+} ResultFormat;
+
+global u64 const RESULT_BUFFER_SIZE = MB(1);
+
+typedef struct ResultSink{
+    Writer writer;
+    ResultFormat format;
+    u32 columns;
+    u64 rows;
+} ResultSink;
+global ResultSink result_sink;
+
+// NOTE: Buffer pool. Pages live in frames handed out by one Pool, a page table (buckets + next_in_bucket chains)
+// maps page numbers to frames. get_page pins the frame it returns, a pinned frame is never evicted, so every
+// get_page needs a matching release_page once the caller stops looking at the node.
+#define FRAME_NONE u32_max
+
+typedef enum FrameState{
+    FrameState_free,
+    FrameState_loading, // NOTE: read is in flight, the frame can't be touched until its completion is reaped
+    FrameState_loaded,
+    FrameState_writing, // NOTE: write back is in flight, the frame can be read but must not change or be reused
+} FrameState;
+
+typedef struct Frame{
+    void* memory; // NOTE: page aligned slot from frame_pool, taken the first time the frame is used
+    u32 page_num;
+    u32 pin_count;
+    u32 next_in_bucket;
+    u8 state;
+    bool dirty;
+    bool referenced; // NOTE: clock bit, set on every get_page, cleared as the clock hand passes
+} Frame;
+
+typedef struct PageRef{
+    void* node;
+    u32 page_num;
+    u32 frame;
+} PageRef;
+
+// NOTE: Plain increments on the hot paths. A table is only ever used by one thread at a time (the server runs the
+// engine under engine_mutex, a libdb handle is single threaded), so the counters need no atomics and cost about
+// as much as per-thread ones. Reset when the table is opened.
+#define TREE_MAX_LEVELS 8 // NOTE: deeper levels are counted with the last one
+
+typedef struct TableCounters{
+    u64 pages_read;     // NOTE: page reads submitted, misses and prefetches
+    u64 pages_written;  // NOTE: write backs submitted, evictions and db_close
+    u64 bytes_flushed;  // NOTE: bytes of completed write backs
+    u64 cache_hits;     // NOTE: get_page found the page in a frame, including pages a prefetch brought in
+    u64 cache_misses;
+    u64 prefetches;     // NOTE: page reads prefetch_page started ahead of get_page
+    u64 leaf_splits;
+    u64 root_splits;    // NOTE: each one adds a level to the tree
+    // NOTE: No internal node split counter, internal nodes don't split yet. internal_node_insert ends the process
+    // when the parent is full, add the counter with the split.
+    u64 level_pages[TREE_MAX_LEVELS]; // NOTE: pages cursors went through, by depth, the root is 0
+} TableCounters;
+
 typedef struct Table{
     u32 num_pages;
     u32 root_page_num;
-    Arena* pages[TABLE_PAGES];
+    u32 file_pages; // NOTE: pages that exist in the db file, anything past this is new
+    OSFile file;
+    IOQueue* io;
+    u32 pending_writes;
+    Pool frame_pool;
+    Frame frames[FRAME_COUNT];
+    u32 buckets[FRAME_BUCKET_COUNT];
+    u32 clock_hand;
+    u32 schema_version; // NOTE: bumped whenever compiled plans could be stale, see plan_cache_prepare
+    // NOTE: A page read or write failed. Sticky until the file is reopened: nothing more is written to it, so it
+    // stays as it was before the failure, and every statement ends in ExecuteResult_io_error.
+    bool io_failed;
+    TableCounters counters;
 } Table;
 global Table table;
 
-static Arena*
+static void*
+frame_node(Table* table, u32 frame_index){
+    return(table->frames[frame_index].memory);
+}
+
+static void
+pager_reap(Table* table, bool wait){
+    PROFILE_FUNCTION;
+    IOCompletion completions[PAGE_IO_DEPTH];
+    u32 count = os_io_poll(table->io, completions, array_count(completions), wait);
+    for(u32 i=0; i < count; ++i){
+        IOCompletion* completion = completions + i;
+        Frame* frame = table->frames + completion->tag;
+        bool failed = (completion->result != PAGE_SIZE);
+        if(failed){
+            print("Failed to %s page %d, the db file isn't written to again until it's reopened.\n",
+                  (completion->op == IOOp_read) ? "read" : "write", frame->page_num);
+            table->io_failed = true;
+        }
+        if(completion->op == IOOp_write){
+            table->pending_writes -= 1;
+            if(!failed){
+                table->counters.bytes_flushed += PAGE_SIZE;
+                table->file_pages = MAX(table->file_pages, frame->page_num + 1);
+            }
+        }
+        else if(failed){
+            // NOTE: Whatever a short read left in the frame can't be trusted. An empty leaf ends any cursor that
+            // lands on it, the statement still fails on io_failed.
+            mem_set(frame_node(table, (u32)completion->tag), 0, PAGE_SIZE);
+            init_leaf_node(frame_node(table, (u32)completion->tag));
+        }
+        frame->state = FrameState_loaded;
+    }
+}
+
+static void
+pager_submit(Table* table, IOOp op, u32 frame_index){
+    PROFILE_FUNCTION;
+    Frame* frame = table->frames + frame_index;
+    if(op == IOOp_write && table->io_failed){
+        // NOTE: Dropped, see Table::io_failed.
+        frame->dirty = false;
+        return;
+    }
+    if(op == IOOp_write){
+        frame->state = FrameState_writing;
+        frame->dirty = false;
+        table->pending_writes += 1;
+        table->counters.pages_written += 1;
+    }
+    else{
+        frame->state = FrameState_loading;
+        table->counters.pages_read += 1;
+    }
+
+    // NOTE: Queue full, make room by reaping whatever has finished.
+    while(!os_io_submit(table->io, op, frame_node(table, frame_index), PAGE_SIZE, (u64)frame->page_num * PAGE_SIZE, frame_index)){
+        pager_reap(table, true);
+    }
+}
+
+static u32
+pager_lookup(Table* table, u32 page_num){
+    u32 frame_index = table->buckets[page_num & (FRAME_BUCKET_COUNT - 1)];
+    while(frame_index != FRAME_NONE && table->frames[frame_index].page_num != page_num){
+        frame_index = table->frames[frame_index].next_in_bucket;
+    }
+    return(frame_index);
+}
+
+static void
+pager_unlink(Table* table, u32 frame_index){
+    u32* link = table->buckets + (table->frames[frame_index].page_num & (FRAME_BUCKET_COUNT - 1));
+    while(*link != frame_index){
+        link = &table->frames[*link].next_in_bucket;
+    }
+    *link = table->frames[frame_index].next_in_bucket;
+}
+
+static u32
+pager_evict(Table* table){
+    // NOTE: Clock sweep. Two full turns are enough to clear every referenced bit, if nothing turns up after
+    // that every frame is pinned or has I/O in flight.
+    for(u32 step=0; step < FRAME_COUNT * 2; ++step){
+        u32 frame_index = table->clock_hand;
+        table->clock_hand = (table->clock_hand + 1) % FRAME_COUNT;
+
+        Frame* frame = table->frames + frame_index;
+        if(frame->state == FrameState_free){
+            return(frame_index);
+        }
+        if(frame->pin_count > 0 || frame->state != FrameState_loaded){
+            continue;
+        }
+        if(frame->referenced){
+            frame->referenced = false;
+            continue;
+        }
+
+        if(frame->dirty){
+            pager_submit(table, IOOp_write, frame_index);
+            while(frame->state == FrameState_writing){
+                pager_reap(table, true);
+            }
+        }
+        pager_unlink(table, frame_index);
+        frame->state = FrameState_free;
+        return(frame_index);
+    }
+    return(FRAME_NONE);
+}
+
+static u32
+pager_load(Table* table, u32 page_num){
+    // NOTE: Gives the page a frame and starts reading it if it lives in the file. Doesn't wait for the read.
+    u32 frame_index = pager_evict(table);
+    if(frame_index == FRAME_NONE){
+        return(frame_index);
+    }
+
+    Frame* frame = table->frames + frame_index;
+    if(!frame->memory){
+        frame->memory = pool_alloc(&table->frame_pool);
+        assert(frame->memory);
+    }
+    u32 bucket = page_num & (FRAME_BUCKET_COUNT - 1);
+    frame->page_num = page_num;
+    frame->pin_count = 0;
+    frame->dirty = false;
+    frame->referenced = false;
+    frame->next_in_bucket = table->buckets[bucket];
+    table->buckets[bucket] = frame_index;
+
+    if(page_num < table->file_pages){
+        pager_submit(table, IOOp_read, frame_index);
+    }
+    else{
+        mem_set(frame_node(table, frame_index), 0, PAGE_SIZE);
+        frame->state = FrameState_loaded;
+    }
+    return(frame_index);
+}
+
+static PageRef
 get_page(Table* table, u32 page_num){
-    Arena* result = table->pages[page_num];
-    if(result == 0){
-        result = os_alloc_arena(PAGE_SIZE);
-        table->pages[page_num] = result;
-    }
-    //if(page_num >= table->num_pages){
-    //    table->num_pages = page_num + 1;
-    //}
-
-    //if(result->used + ROW_SIZE > result->size){
-    //    result = table->pages[table->num_pages++];
-    //}
-    //Arena* result = table->pages[page_num];
+    u32 frame_index = pager_lookup(table, page_num);
+    if(frame_index == FRAME_NONE){
+        table->counters.cache_misses += 1;
+        frame_index = pager_load(table, page_num);
+        if(frame_index == FRAME_NONE){
+            print("Out of page frames, all %d are pinned.\n", FRAME_COUNT);
+            exit(EXIT_FAILURE);
+        }
+    }
+    else{
+        table->counters.cache_hits += 1;
+    }
+
+    // NOTE: Pin before waiting on the read, so reaping other completions can't hand this frame out.
+    Frame* frame = table->frames + frame_index;
+    frame->pin_count += 1;
+    frame->referenced = true;
+    while(frame->state == FrameState_loading){
+        pager_reap(table, true);
+    }
+
     if(page_num >= table->num_pages){
         table->num_pages = page_num + 1;
     }
+
+    PageRef result = {frame_node(table, frame_index), page_num, frame_index};
     return(result);
 }
 
+static void
+release_page(Table* table, PageRef* page){
+    Frame* frame = table->frames + page->frame;
+    assert(frame->pin_count > 0);
+    frame->pin_count -= 1;
+    page->node = 0;
+}
+
+static void
+mark_page_dirty(Table* table, PageRef* page){
+    // NOTE: A frame that is being written back still has the old contents on its way to disk. Wait for it,
+    // the frame is clean afterwards and this change makes it dirty again.
+    Frame* frame = table->frames + page->frame;
+    while(frame->state == FrameState_writing){
+        pager_reap(table, true);
+    }
+    frame->dirty = true;
+}
+
+static void
+prefetch_page(Table* table, u32 page_num){
+    // NOTE: Resident pages get a cache prefetch of the frame, pages still on disk get an async read.
+    if(page_num >= table->num_pages){
+        return;
+    }
+    u32 frame_index = pager_lookup(table, page_num);
+    if(frame_index == FRAME_NONE){
+        if(pager_load(table, page_num) != FRAME_NONE){
+            table->counters.prefetches += 1;
+            os_io_flush(table->io);
+        }
+    }
+    else if(table->frames[frame_index].state != FrameState_loading){
+        mem_prefetch(frame_node(table, frame_index), PAGE_SIZE);
+    }
+}
+
+static void
+prefetch_leaf_chain(Table* table, void* leaf){
+    // NOTE: Start pulling in the next few leaves of a scan before the cursor gets there. Reading a next pointer
+    // can still miss, but those pages were already prefetched when the cursor entered the previous leaf.
+    // The chain stops at the first page that isn't loaded, we can't follow its next pointer until it arrives.
+    pager_reap(table, false);
+    u32 page_num = *leaf_node_next_leaf(leaf);
+    for(u32 i=0; i < LEAF_PREFETCH_DISTANCE && page_num != 0; ++i){
+        prefetch_page(table, page_num);
+        u32 frame_index = pager_lookup(table, page_num);
+        if(frame_index == FRAME_NONE || table->frames[frame_index].state == FrameState_loading){
+            break;
+        }
+        page_num = *leaf_node_next_leaf(frame_node(table, frame_index));
+    }
+}
+
+// NOTE: Cursors are plain values, they live on the caller's stack and never allocate.
+//
+// usage:
+//     for(Cursor c = cursor_begin(table); cursor_valid(&c); cursor_next_leaf(&c)){
+//         void* node = cursor_node(&c);
+//         for(u32 i=c.cell_num; i < *leaf_node_num_cells(node); ++i){
+//             ... leaf_node_id(node, i) ...
+//         }
+//     }
+// A valid cursor keeps its leaf pinned. Running off the end releases it, stopping early needs cursor_close().
+// There is no per cell step, the scan kernels read a leaf's cells straight out of the node and one would only add
+// a call and a branch per row to what they already do.
 typedef struct Cursor{
     Table* table;
-    u32 page_num;
+    PageRef leaf;
     u32 cell_num;
+    u32 level; // NOTE: depth of the leaves, for TableCounters::level_pages
     bool end_of_table;
 } Cursor;
 
-//static Cursor*
-//cursor_start(Table* table){
-//    Cursor* c = push_struct(tm, Cursor);
-//    c->table = table;
-//    c->page_num = table->root_page_num;
-//    c->cell_num = 0;
-//
-//    Arena* root_node = get_page(table, table->root_page_num);
-//    u32 num_cells = *leaf_node_num_cells(root_node->base);
-//    c->end_of_table = (num_cells == 0);
-//    return(c);
-//}
-
-static Cursor*
-cursor_end(Table* table){
-    Cursor* c = push_struct(tm, Cursor);
-    c->table = table;
-    c->page_num = table->root_page_num;
-    Arena* root_node = get_page(table, table->root_page_num);
-    c->cell_num = *leaf_node_num_cells(root_node->base);
-
-    c->end_of_table = true;
-    return(c);
-}
-
-static Cursor*
+static Cursor
 leaf_node_find(Table* table, u32 page_num, u32 key){
-    Arena* node = get_page(table, page_num);
-    u32 num_cells = *leaf_node_num_cells(node->base);
+    Cursor c = ZERO_INIT;
+    c.table = table;
+    c.leaf = get_page(table, page_num);
 
-    Cursor* c = push_struct(tm, Cursor);
-    c->table = table;
-    c->page_num = page_num;
+    void* node = c.leaf.node;
+    u32 num_cells = *leaf_node_num_cells(node);
 
     // NOTE: binary search
     u32 min_index = 0;
     u32 opl_index = num_cells;
     while(min_index != opl_index){
         u32 index = (min_index + opl_index) / 2;
-        u32 key_at_index = *leaf_node_key(node->base, index);
+        u32 key_at_index = *leaf_node_key(node, index);
         if(key == key_at_index){
-            c->cell_num = index;
+            c.cell_num = index;
             return(c);
         }
         if(key < key_at_index){
@@ -332,126 +786,205 @@ leaf_node_find(Table* table, u32 page_num, u32 key){
         }
     }
 
-    c->cell_num = min_index;
+    c.cell_num = min_index;
     return(c);
 }
 
 static u32
-internal_node_find_child(void* node, u32 key){
-    // NOTE: Return the index of the child which should contain the given key.
-    u32 num_keys = *internal_node_num_keys(node);
-
-    // NOTE: Binary search
-    u32 min_index = 0;
-    u32 max_index = num_keys;
-    while(min_index != max_index){
-        u32 index = (min_index + max_index) / 2;
-        u32 key_to_right = *internal_node_key(node, index);
-        if(key_to_right >= key){
-            max_index = index;
+leaf_node_upper_bound(void* node, u32 begin, u32 end, u32 key){
+    // NOTE: First cell in [begin, end) with a key > key, end if there is none.
+    while(begin != end){
+        u32 index = (begin + end) / 2;
+        if(*leaf_node_key(node, index) > key){
+            end = index;
         }
         else{
-            min_index = index + 1;
+            begin = index + 1;
         }
     }
-    return(min_index);
+    return(begin);
 }
 
-static void
-update_internal_node_key(void* node, u32 old_key, u32 new_key){
-    u32 old_child_index = internal_node_find_child(node, old_key);
-    *internal_node_key(node, old_child_index) = new_key;
+static u32
+internal_node_count_keys_less(u32* keys, u32 count, u32 key){
+    // NOTE: Counts how many of the (sorted) keys are < key, without branching on the keys themselves.
+    // Reading up to 3 keys past count is fine, the children array follows the keys in the page.
+#if ARCH_AMD64
+    __m128i bias = _mm_set1_epi32((s32)0x80000000);
+    __m128i key_biased = _mm_xor_si128(_mm_set1_epi32((s32)key), bias);
+    __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+    __m128i total = _mm_setzero_si128();
+    for(u32 i=0; i < count; i += 4){
+        // NOTE: SSE2 only has signed compares, flip the sign bit to compare unsigned keys.
+        __m128i keys_biased = _mm_xor_si128(_mm_loadu_si128((__m128i*)(keys + i)), bias);
+        __m128i less = _mm_cmpgt_epi32(key_biased, keys_biased);
+        __m128i valid = _mm_cmpgt_epi32(_mm_set1_epi32((s32)(count - i)), lanes);
+        total = _mm_sub_epi32(total, _mm_and_si128(less, valid));
+    }
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(1, 0, 3, 2)));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(2, 3, 0, 1)));
+    u32 result = (u32)_mm_cvtsi128_si32(total);
+#else
+    u32 result = 0;
+    for(u32 i=0; i < count; ++i){
+        result += (keys[i] < key);
+    }
+#endif
+    return(result);
 }
 
-static Cursor*
-internal_node_find(Table* table, u32 page_num, u32 key){
-    void* node = get_page(table, page_num)->base;
+static u32
+internal_node_find_child(void* node, u32 key){
+    // NOTE: Return the index of the child which should contain the given key.
+    // That is the index of the first key >= the given key (num_keys means the right child).
     u32 num_keys = *internal_node_num_keys(node);
-
-    u32 child_index = internal_node_find_child(node, key);
-    u32 child_num = *internal_node_child(node, child_index);
-    void* child = get_page(table, child_num)->base;
-    switch(get_node_type(child)){
-        case NodeType_leaf:
-            return(leaf_node_find(table, child_num, key));
-        case NodeType_internal:
-            return(internal_node_find(table, child_num, key));
+    u32* keys = internal_node_keys(node);
+
+    // NOTE: Branchless binary search. Everything before base is < key, the answer is in [base, base + count].
+    u32 base = 0;
+    u32 count = num_keys;
+    while(count > INTERNAL_NODE_SEARCH_WINDOW){
+        u32 half = count / 2;
+        bool less = (keys[base + half - 1] < key);
+        base = less ? (base + half) : base;
+        count = less ? (count - half) : half;
     }
+
+    u32 result = base + internal_node_count_keys_less(keys + base, count, key);
+    return(result);
 }
 
-static Cursor*
-cursor_find(Table* table, u32 key){
-    u32 root_page_num = table->root_page_num;
-    Arena* root_node = get_page(table, root_page_num);
+static void
+update_internal_node_key(void* node, u32 old_key, u32 new_key){
+    u32 old_child_index = internal_node_find_child(node, old_key);
+    *internal_node_key(node, old_child_index) = new_key;
+}
 
-    if((get_node_type(root_node->base) == NodeType_leaf)){
-        return(leaf_node_find(table, root_page_num, key));
-    }
-    else{
-        //print("Need to implement searching an internal node.\n");
-        //exit(EXIT_FAILURE);
-        return(internal_node_find(table, root_page_num, key));
+static Cursor
+cursor_find(Table* table, u32 key){
+    PROFILE_FUNCTION;
+    // NOTE: Position of key in its leaf, or the position it would be inserted at. That can be one past the
+    // last cell of the leaf, use cursor_seek() to iterate from a key.
+    PageRef page = get_page(table, table->root_page_num);
+    u32 level = 0;
+    while(get_node_type(page.node) == NodeType_internal){
+        table->counters.level_pages[MIN(level, TREE_MAX_LEVELS - 1)] += 1;
+        u32 child_index = internal_node_find_child(page.node, key);
+        u32 child_page_num = *internal_node_child(page.node, child_index);
+        release_page(table, &page);
+        page = get_page(table, child_page_num);
+        level += 1;
     }
+    u32 page_num = page.page_num;
+    release_page(table, &page);
+    Cursor c = leaf_node_find(table, page_num, key);
+    c.level = MIN(level, TREE_MAX_LEVELS - 1);
+    table->counters.level_pages[c.level] += 1;
+    return(c);
 }
 
-static Cursor*
-cursor_start(Table* table){
-    Cursor* c = cursor_find(table, 0);
-    //c->table = table;
-    //c->page_num = table->root_page_num;
-    //c->cell_num = 0;
-
-    void* node = get_page(table, c->page_num)->base;
-    u32 num_cells = *leaf_node_num_cells(node);
-    c->end_of_table = (num_cells == 0);
-    return(c);
+static void*
+cursor_node(Cursor* c){
+    return(c->leaf.node);
 }
 
-static Row*
-cursor_at(Cursor* c){
-    void* node = get_page(c->table, c->page_num)->base;
-    Row* row = (Row*)leaf_node_value(node, c->cell_num);
-    return(row);
+static bool
+cursor_valid(Cursor* c){
+    return(!c->end_of_table);
 }
 
 static void
-cursor_next(Cursor* c){
-    void* node = get_page(c->table, c->page_num)->base;
+cursor_close(Cursor* c){
+    if(c->leaf.node != 0){
+        release_page(c->table, &c->leaf);
+    }
+    c->end_of_table = true;
+}
 
-    c->cell_num += 1;
-    u32 num_cells = *leaf_node_num_cells(node);
-    if(c->cell_num >= num_cells){
-        //c->end_of_table = true;
+static void
+cursor_skip_exhausted_leaves(Cursor* c){
+    // NOTE: Moves a cursor sitting past the last cell of its leaf onto the first cell of the next non empty leaf.
+    while(c->cell_num >= *leaf_node_num_cells(c->leaf.node)){
         // NOTE: Advance to next leaf node
-        u32 next_page_num = *leaf_node_next_leaf(node);
+        u32 next_page_num = *leaf_node_next_leaf(c->leaf.node);
         if(next_page_num == 0){
             // NOTE: This was right most leaf
-            c->end_of_table = true;
-        }
-        else{
-            c->page_num = next_page_num;
-            c->cell_num = 0;
+            cursor_close(c);
+            return;
         }
+        release_page(c->table, &c->leaf);
+        c->leaf = get_page(c->table, next_page_num);
+        c->cell_num = 0;
+        c->table->counters.level_pages[c->level] += 1;
+        prefetch_leaf_chain(c->table, c->leaf.node);
     }
 }
 
+static Cursor
+cursor_seek(Table* table, u32 key){
+    // NOTE: First cell with a key >= key.
+    Cursor c = cursor_find(table, key);
+    cursor_skip_exhausted_leaves(&c);
+    return(c);
+}
+
+static Cursor
+cursor_begin(Table* table){
+    Cursor c = cursor_find(table, 0);
+    prefetch_leaf_chain(table, cursor_node(&c));
+    cursor_skip_exhausted_leaves(&c);
+    return(c);
+}
+
 static void
+cursor_next_leaf(Cursor* c){
+    // NOTE: Skips the rest of the cursor's leaf, onto the first cell of the next non empty one.
+    c->cell_num = *leaf_node_num_cells(c->leaf.node);
+    cursor_skip_exhausted_leaves(c);
+}
+
+static bool
 init_table(Table* table){
     table->num_pages = 0;
-    table->root_page_num = 0;
-    for(u32 i=0; i < TABLE_PAGES; ++i){
-        table->pages[i] = 0;
+    table->root_page_num = ROOT_PAGE_NUM;
+    table->file_pages = 0;
+    table->pending_writes = 0;
+    table->clock_hand = 0;
+    table->schema_version += 1;
+    table->io_failed = false;
+    table->counters = ZERO_INIT;
+    // NOTE: Reserves room for every frame, memory is only committed as frames are first used.
+    u32 pool_flags = huge_pages ? PoolFlag_huge_pages : 0;
+    if(!pool_init(&table->frame_pool, PAGE_SIZE, PAGE_SIZE, FRAME_COUNT, pool_flags)){
+        print("Failed to reserve the frame pool.\n");
+        return(false);
+    }
+    for(u32 i=0; i < FRAME_COUNT; ++i){
+        Frame* frame = table->frames + i;
+        frame->memory = 0;
+        frame->page_num = 0;
+        frame->pin_count = 0;
+        frame->next_in_bucket = FRAME_NONE;
+        frame->state = FrameState_free;
+        frame->dirty = false;
+        frame->referenced = false;
+    }
+    for(u32 i=0; i < FRAME_BUCKET_COUNT; ++i){
+        table->buckets[i] = FRAME_NONE;
     }
+    return(true);
 }
 
 static void
 print_constants() {
+  print("PAGE_SIZE: %d\n", PAGE_SIZE);
   print("ROW_SIZE: %d\n", ROW_SIZE);
   print("COMMON_NODE_HEADER_SIZE: %d\n", COMMON_NODE_HEADER_SIZE);
   print("LEAF_NODE_HEADER_SIZE: %d\n", LEAF_NODE_HEADER_SIZE);
   print("LEAF_NODE_CELL_SIZE: %d\n", LEAF_NODE_CELL_SIZE);
   print("LEAF_NODE_SPACE_FOR_CELLS: %d\n", LEAF_NODE_SPACE_FOR_CELLS);
   print("LEAF_NODE_MAX_CELLS: %d\n", LEAF_NODE_MAX_CELLS);
+  print("LEAF_NODE_PAX: %d\n", LEAF_NODE_PAX);
 }
 
 static void
@@ -463,7 +996,8 @@ indent(u32 level){
 
 static void
 print_tree(Table* table, u32 page_num, u32 indentation_level){
-    void* node = get_page(table, page_num)->base;
+    PageRef page = get_page(table, page_num);
+    void* node = page.node;
     u32 num_keys;
     u32 child;
 
@@ -492,6 +1026,7 @@ print_tree(Table* table, u32 page_num, u32 indentation_level){
             print_tree(table, child, indentation_level + 1);
             break;
     }
+    release_page(table, &page);
 }
 
 static void
@@ -506,150 +1041,888 @@ print_leaf_node(void* node) {
 
 static void
 db_close(Table* table){
-    u64 offset = 0;
-    // IMPORTANT: potential memory access violation here if we are not skipping the last page.
-    for(u32 i=0; i <= table->num_pages; ++i){
-        //if(i == table->num_pages && row_offset == 0){
-        //    continue;
-        //}
-        Arena* page = table->pages[i];
-        if(page != 0){
-            FileData data = {page->base, page->size};
-            os_file_write(data, dir, filename, offset);
-            offset += page->size;
+    // NOTE: Reads still in flight own their frames, let them land before writing anything.
+    for(u32 i=0; i < FRAME_COUNT; ++i){
+        while(table->frames[i].state == FrameState_loading){
+            pager_reap(table, true);
         }
     }
-}
-
-static void
-db_open(Arena* arena, Table* table){
-    FileData file = os_file_read(arena, dir, filename);
 
-    u32 remainder = file.size % PAGE_SIZE;
-    if(remainder){
-        print("db file is not a while number of pages. Corrupt file.\n");
-        exit(EXIT_FAILURE);
+    // NOTE: Write back every dirty frame as one batch, then wait for all of them.
+    for(u32 i=0; i < FRAME_COUNT; ++i){
+        if(table->frames[i].dirty){
+            pager_submit(table, IOOp_write, i);
+        }
+    }
+    os_io_flush(table->io);
+    while(table->pending_writes > 0){
+        pager_reap(table, true);
+    }
+    if(table->io_failed){
+        print("Closed the db after a failed page read or write, changes since then were not saved.\n");
     }
 
-    u32 num_pages = file.size / PAGE_SIZE;
-    table->num_pages = num_pages;
-    if(file.size == 0){
-        // NOTE: new database. init page 0 as leaf node.
-        Arena* page = os_alloc_arena(PAGE_SIZE);
-        init_leaf_node(page->base);
-        set_node_root(page->base, true);
-        table->pages[0] = page;
-    } else{
-        for(u32 i=0; i < num_pages; ++i){
-            Arena* page = table->pages[i];
+    os_io_destroy(table->io);
+    os_file_close(table->file);
 
-            page = os_alloc_arena(PAGE_SIZE);
-            page->base = (u8*)file.base + (i * PAGE_SIZE);
-            //page->used = ROWS_PER_PAGE * ROW_SIZE;
-            table->pages[i] = page;
-        }
-        //table->pages[num_pages]->used = row_remainder * ROW_SIZE;
+    for(u32 i=0; i < FRAME_COUNT; ++i){
+        pool_free(&table->frame_pool, table->frames[i].memory);
+        table->frames[i].memory = 0;
     }
+    pool_release(&table->frame_pool);
 }
 
-static MetaCommand
-do_meta_command(String8 input){
-    if(input == str8_literal(".exit")){
-        print("quiting");
-        db_close(&table);
-        running = false;
-        exit(EXIT_SUCCESS);
-        return(MetaCommand_success);
-    }
-    if(input == str8_literal(".constants")){
-        print_constants();
-        return(MetaCommand_success);
-    }
-    if(input == str8_literal(".btree")){
-        print("Tree:\n");
-        print_tree(&table, 0, 0);
-        //print_leaf_node(get_page(&table, 0)->base);
-        return(MetaCommand_success);
+static void
+file_header_write(void* page){
+    mem_set(page, 0, PAGE_SIZE);
+    mem_copy((u8*)page + FILE_MAGIC_OFFSET, FILE_MAGIC, FILE_MAGIC_SIZE);
+    *(u32*)((u8*)page + FILE_VERSION_OFFSET) = FILE_FORMAT_VERSION;
+    *(u32*)((u8*)page + FILE_PAGE_SIZE_OFFSET) = PAGE_SIZE;
+    *(u32*)((u8*)page + FILE_LEAF_LAYOUT_OFFSET) = LEAF_NODE_PAX;
+}
+
+// NOTE: Says why and returns false when the file wasn't written with this build's page layout.
+static bool
+file_header_check(void* page){
+    if(!mem_match((u8*)page + FILE_MAGIC_OFFSET, FILE_MAGIC, FILE_MAGIC_SIZE)){
+        print("db file has no header. It's not a db file, or was written before the file format was versioned.\n");
+        return(false);
     }
-    else{
-        return(MetaCommand_unrecognized);
+    u32 version = *(u32*)((u8*)page + FILE_VERSION_OFFSET);
+    u32 page_size = *(u32*)((u8*)page + FILE_PAGE_SIZE_OFFSET);
+    u32 leaf_layout = *(u32*)((u8*)page + FILE_LEAF_LAYOUT_OFFSET);
+    if(version != FILE_FORMAT_VERSION || page_size != PAGE_SIZE || leaf_layout != LEAF_NODE_PAX){
+        print("db file is format version %d with %d byte pages and LEAF_NODE_PAX=%d, this build reads version %d with %d byte pages and LEAF_NODE_PAX=%d.\n",
+              version, page_size, leaf_layout, FILE_FORMAT_VERSION, PAGE_SIZE, LEAF_NODE_PAX);
+        return(false);
     }
+    return(true);
 }
 
-static PrepareResult
-prepare_insert(String8 input, Statement* statement){
-    statement->type = StatementType_insert;
-
-    char* keyword = strtok((char*)input.str, " ");
-    char* id_string = strtok(0, " ");
-    char* username = strtok(0, " ");
-    char* email = strtok(0, " ");
-
-    if(id_string == 0 || username == 0 || email == 0){
-        return(PrepareResult_syntax_error);
+// NOTE: The db file is dir followed by file_name. Returns false if it can't be opened or isn't a db file, the
+// table is left closed then. The file's own directory is created if it's missing (a fresh checkout has no data/),
+// anything above it has to exist.
+static bool
+db_open(Arena* arena, Table* table, String8 dir, String8 file_name){
+    u64 parent_size = file_name.size;
+    while(parent_size > 0 && file_name.str[parent_size - 1] != '/' && file_name.str[parent_size - 1] != '\\'){
+        parent_size -= 1;
+    }
+    if(parent_size > 1){
+        // NOTE: Fails when the directory already exists, which is the usual case.
+        os_dir_create(dir, str8(file_name.str, parent_size - 1));
     }
 
-    u64 username_length = str_length(username);
-    if(username_length > USERNAME_SIZE){
-        return(PrepareResult_username_too_long);
+    // NOTE: A direct open that fails is retried buffered, the OS layer only reports the open that decides.
+    u32 file_flags = direct_io ? (OSFileFlag_direct|OSFileFlag_quiet) : 0;
+    table->file = os_file_open(dir, file_name, file_flags);
+    if(!os_file_is_valid(table->file) && direct_io){
+        print("Direct I/O is not supported for the db file, falling back to buffered I/O.\n");
+        file_flags = 0;
+        table->file = os_file_open(dir, file_name, file_flags);
     }
-    u64 email_length = str_length(email);
-    if(email_length > EMAIL_SIZE){
-        return(PrepareResult_email_too_long);
+    if(!os_file_is_valid(table->file)){
+        return(false);
     }
-    s32 id = atoi(id_string); // NOTE: strtol is more flexible. consider using it later
-    if(id < 0){
-        return(PrepareResult_negative_id);
+    if(file_flags & OSFileFlag_direct){
+        u32 block_size = os_file_block_size(table->file);
+        if(block_size == 0 || (PAGE_SIZE % block_size) != 0){
+            print("PAGE_SIZE %d is not a multiple of the block size %d, falling back to buffered I/O.\n", PAGE_SIZE, block_size);
+            os_file_close(table->file);
+            table->file = os_file_open(dir, file_name, 0);
+        }
+    }
+    u64 file_size = os_file_size(table->file);
+
+    // NOTE: Anything but an empty file needs the header and a root page.
+    if((file_size % PAGE_SIZE) != 0 || (file_size != 0 && file_size < 2 * (u64)PAGE_SIZE)){
+        print("db file is %llu bytes, not a header and a root of %d byte pages. It's corrupt, not a db file, or was written with a different PAGE_SIZE.\n",
+              (unsigned long long)file_size, PAGE_SIZE);
+        os_file_close(table->file);
+        return(false);
     }
 
-    statement->row.id = (u32)id;
-    strcpy(statement->row.username, username);
-    strcpy(statement->row.email, email);
-
-    return(PrepareResult_success);
+    // NOTE: Pages are read in lazily by get_page.
+    u32 num_pages = file_size / PAGE_SIZE;
+    table->num_pages = num_pages;
+    table->file_pages = num_pages;
+    table->io = os_io_create(arena, table->file, PAGE_IO_DEPTH);
+    PageRef header = get_page(table, FILE_HEADER_PAGE_NUM);
+    if(file_size == 0){
+        // NOTE: new database. Write the header, init the root as an empty leaf.
+        file_header_write(header.node);
+        mark_page_dirty(table, &header);
+        release_page(table, &header);
+        PageRef page = get_page(table, table->root_page_num);
+        init_leaf_node(page.node);
+        set_node_root(page.node, true);
+        mark_page_dirty(table, &page);
+        release_page(table, &page);
+    }
+    else{
+        bool header_matches = file_header_check(header.node);
+        release_page(table, &header);
+        if(!header_matches){
+            os_io_destroy(table->io);
+            os_file_close(table->file);
+            return(false);
+        }
+    }
+    return(true);
 }
 
-static PrepareResult
-prepare_statement(String8 input, Statement* statement){
-    PrepareResult result = ZERO_INIT;
-    if(str8_starts_with(input, str8_literal("insert"))){
-        result = prepare_insert(input, statement);
-        return(result);
+///////////////////////////////
+// NOTE: Stats
+///////////////////////////////
+// NOTE: A table's counters plus what has to be measured: the tree's shape and the arenas' high water marks.
+// Measuring walks the tree through get_page, the counters are copied first so the walk doesn't count itself.
+// On a table bigger than the buffer pool the walk reads pages in, it's meant for `.stats`, not hot paths.
+
+typedef struct TableStats{
+    TableCounters counters;
+    u32 tree_height;
+    u32 page_count;
+    u64 rows;
+    u64 arena_high_water;      // NOTE: the arena the table was opened with
+    u64 temp_arena_high_water; // NOTE: tm, the per statement arena
+} TableStats;
+
+// NOTE: get_page for the stats walk. A page it had to read comes back unreferenced, the clock sweep hands that
+// frame out first, so counting rows doesn't push the working set out of the pool.
+static PageRef
+stats_get_page(Table* table, u32 page_num){
+    bool resident = (pager_lookup(table, page_num) != FRAME_NONE);
+    PageRef result = get_page(table, page_num);
+    if(!resident){
+        table->frames[result.frame].referenced = false;
     }
+    return(result);
+}
 
-    if(str8_starts_with(input, str8_literal("select"))){
-        statement->type = StatementType_select;
-        return(PrepareResult_success);
+static void
+table_collect_stats(Table* table, Arena* arena, TableStats* stats){
+    stats->counters = table->counters;
+    stats->page_count = table->num_pages;
+    stats->arena_high_water = arena->high_water;
+    stats->temp_arena_high_water = tm->high_water;
+
+    // NOTE: Down the leftmost edge for the height, then along the leaf chain for the rows.
+    stats->tree_height = 1;
+    PageRef page = stats_get_page(table, table->root_page_num);
+    while(get_node_type(page.node) == NodeType_internal){
+        u32 child_page_num = *internal_node_child(page.node, 0);
+        release_page(table, &page);
+        page = stats_get_page(table, child_page_num);
+        stats->tree_height += 1;
+    }
+    stats->rows = 0;
+    for(;;){
+        stats->rows += *leaf_node_num_cells(page.node);
+        u32 next_page_num = *leaf_node_next_leaf(page.node);
+        release_page(table, &page);
+        if(next_page_num == 0){
+            break;
+        }
+        page = stats_get_page(table, next_page_num);
     }
 
-    return(PrepareResult_unrecognized_statement);
+    // NOTE: The walk is bookkeeping, not work the table did.
+    table->counters = stats->counters;
 }
 
 static void
-serialize_row(void* dest, Row* row){
-    memcpy((u8*)dest + ID_OFFSET, &row->id, ID_SIZE);
-    memcpy((u8*)dest + USERNAME_OFFSET, row->username, USERNAME_SIZE);
-    memcpy((u8*)dest + EMAIL_OFFSET, row->email, EMAIL_SIZE);
+stats_push_line(Writer* w, String8 name, u64 value){
+    writer_push_str8(w, name);
+    for(u64 i=name.size; i < 24; ++i){
+        writer_push_u8(w, ' ');
+    }
+    writer_push_u64(w, value);
+    writer_push_u8(w, '\n');
 }
 
 static void
-deserialize_row(Row* row){
-    print("(%d, %s, %s)\n", row->id, row->username, row->email);
+table_write_stats(Writer* w, TableStats* stats){
+    stats_push_line(w, str8_literal("pages read"), stats->counters.pages_read);
+    stats_push_line(w, str8_literal("pages written"), stats->counters.pages_written);
+    stats_push_line(w, str8_literal("bytes flushed"), stats->counters.bytes_flushed);
+    stats_push_line(w, str8_literal("cache hits"), stats->counters.cache_hits);
+    stats_push_line(w, str8_literal("cache misses"), stats->counters.cache_misses);
+    stats_push_line(w, str8_literal("prefetches"), stats->counters.prefetches);
+    stats_push_line(w, str8_literal("leaf splits"), stats->counters.leaf_splits);
+    stats_push_line(w, str8_literal("root splits"), stats->counters.root_splits);
+    stats_push_line(w, str8_literal("tree height"), stats->tree_height);
+    stats_push_line(w, str8_literal("page count"), stats->page_count);
+    stats_push_line(w, str8_literal("rows"), stats->rows);
+    stats_push_line(w, str8_literal("arena high water"), stats->arena_high_water);
+    stats_push_line(w, str8_literal("temp arena high water"), stats->temp_arena_high_water);
 }
 
-static u32
-get_unused_page_num(Table* table){
-    return(table->num_pages);
+///////////////////////////////
+// NOTE: Statement Latency
+///////////////////////////////
+// NOTE: A histogram per kind of statement of how long its vm ran, in cpu timer ticks, converted when reported.
+// Recorded in vm_execute, so repl, script and server statements count, library steps don't: a paused vm's time
+// is the caller's. Updated under whatever runs the engine, the engine mutex on the server.
+
+typedef enum StatementKind{
+    StatementKind_insert,
+    StatementKind_point_select, // NOTE: id = value
+    StatementKind_range_select, // NOTE: id bounded by <, <=, >, >=
+    StatementKind_scan_select,  // NOTE: anything else walks every leaf
+    StatementKind_COUNT,
+} StatementKind;
+
+global char const* statement_kind_names[StatementKind_COUNT] = {"insert", "point select", "range select", "scan select"};
+
+global Histogram statement_latency[StatementKind_COUNT];
+
+static StatementKind
+statement_kind(Statement* statement){
+    if(statement->type == StatementType_insert){
+        return(StatementKind_insert);
+    }
+    StatementKind result = StatementKind_scan_select;
+    for(u32 i=0; i < statement->filter.count; ++i){
+        Predicate* term = statement->filter.terms + i;
+        if(term->column != Column_id){
+            continue;
+        }
+        if(term->op == CompareOp_eq){
+            return(StatementKind_point_select);
+        }
+        if(term->op == CompareOp_lt || term->op == CompareOp_le || term->op == CompareOp_gt || term->op == CompareOp_ge){
+            result = StatementKind_range_select;
+        }
+    }
+    return(result);
+}
+
+static void
+latency_reset(Histogram* histograms){
+    for(u32 i=0; i < StatementKind_COUNT; ++i){
+        histogram_reset(histograms + i);
+    }
+}
+
+// NOTE: One line per kind that ran, times in microseconds.
+static void
+latency_write_report(Writer* w, Histogram* histograms){
+    f64 us_per_tick = 1000000.0 / (f64)cpu_timer_frequency();
+    writer_push_format(w, "%-14s %10s %10s %10s %10s %10s %10s %10s  (us)\n", "statement", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for(u32 i=0; i < StatementKind_COUNT; ++i){
+        Histogram* h = histograms + i;
+        if(h->count == 0){
+            continue;
+        }
+        writer_push_format(w, "%-14s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+                            statement_kind_names[i], (unsigned long long)h->count,
+                            ((f64)h->total / (f64)h->count) * us_per_tick,
+                            (f64)histogram_percentile(h, 0.5) * us_per_tick,
+                            (f64)histogram_percentile(h, 0.9) * us_per_tick,
+                            (f64)histogram_percentile(h, 0.99) * us_per_tick,
+                            (f64)histogram_percentile(h, 0.999) * us_per_tick,
+                            (f64)h->max * us_per_tick);
+    }
+}
+
+// NOTE: Every non empty bucket as csv, for plotting or merging runs: the bucket's range in nanoseconds, its count
+// and the fraction of the kind's statements at or below it.
+static void
+latency_write_buckets(Writer* w, Histogram* histograms){
+    f64 ns_per_tick = 1000000000.0 / (f64)cpu_timer_frequency();
+    writer_push_str8(w, str8_literal("statement,low_ns,high_ns,count,cumulative\n"));
+    for(u32 i=0; i < StatementKind_COUNT; ++i){
+        Histogram* h = histograms + i;
+        u64 seen = 0;
+        for(u32 bucket=0; bucket < HISTOGRAM_BUCKET_COUNT; ++bucket){
+            u64 count = h->buckets[bucket];
+            if(count == 0){
+                continue;
+            }
+            seen += count;
+            writer_push_format(w, "%s,%.0f,%.0f,%llu,%.6f\n", statement_kind_names[i],
+                                (f64)histogram_bucket_low(bucket) * ns_per_tick,
+                                (f64)(histogram_bucket_high(bucket) + 1) * ns_per_tick,
+                                (unsigned long long)count, (f64)seen / (f64)h->count);
+        }
+    }
+}
+
+// NOTE: Writer flush target that appends to a file, the file is written from the start, delete it first.
+typedef struct FileOutput{
+    String8 path;
+    u64 offset;
+} FileOutput;
+
+static void
+file_output_flush(void* user, u8* data, u64 size){
+    FileOutput* output = (FileOutput*)user;
+    FileData file_data = {data, size};
+    os_file_write(file_data, str8_literal(""), output->path, output->offset);
+    output->offset += size;
+}
+
+static void
+latency_write_file(String8 path, Histogram* histograms){
+    FileOutput output = {path, 0};
+    os_file_delete(str8_literal(""), path);
+    Writer w = writer_make(tm, KB(64), file_output_flush, &output);
+    latency_write_report(&w, histograms);
+    latency_write_buckets(&w, histograms);
+    writer_flush(&w);
+}
+
+static MetaCommand
+do_meta_command(String8 input){
+    if(input == str8_literal(".exit")){
+        // NOTE: Ends the repl or script loop, which closes the table, a script still reports its errors.
+        print("quiting");
+        running = false;
+        return(MetaCommand_success);
+    }
+    if(input == str8_literal(".constants")){
+        print_constants();
+        return(MetaCommand_success);
+    }
+    if(str8_starts_with(input, str8_literal(".mode"))){
+        // NOTE: .mode text|csv|binary, how select rows are written out.
+        String8 mode = str8_substr_left(input, str8_literal(".mode ").size, input.size);
+        if(mode == str8_literal("text")){
+            result_sink.format = ResultFormat_text;
+        }
+        else if(mode == str8_literal("csv")){
+            result_sink.format = ResultFormat_csv;
+        }
+        else if(mode == str8_literal("binary")){
+            result_sink.format = ResultFormat_binary;
+        }
+        else{
+            print("Unknown mode: '%.*s', expected text, csv or binary.\n", (s32)mode.size, mode.str);
+        }
+        return(MetaCommand_success);
+    }
+    if(input == str8_literal(".stats")){
+        TableStats stats;
+        table_collect_stats(&table, pm, &stats);
+        table_write_stats(&result_sink.writer, &stats);
+        writer_flush(&result_sink.writer);
+        return(MetaCommand_success);
+    }
+    if(input == str8_literal(".profile")){
+        profile_write_report(&result_sink.writer);
+        writer_flush(&result_sink.writer);
+        return(MetaCommand_success);
+    }
+    if(input == str8_literal(".profile reset")){
+        profile_reset();
+        return(MetaCommand_success);
+    }
+    if(input == str8_literal(".latency")){
+        latency_write_report(&result_sink.writer, statement_latency);
+        writer_flush(&result_sink.writer);
+        return(MetaCommand_success);
+    }
+    if(input == str8_literal(".latency reset")){
+        latency_reset(statement_latency);
+        return(MetaCommand_success);
+    }
+    if(str8_starts_with(input, str8_literal(".latency dump "))){
+        // NOTE: .latency dump <path>, the report and every bucket.
+        String8 path = str8_substr_left(input, str8_literal(".latency dump ").size, input.size);
+        latency_write_file(path, statement_latency);
+        print("Wrote statement latencies to '%.*s'\n", (s32)path.size, path.str);
+        return(MetaCommand_success);
+    }
+    if(input == str8_literal(".btree")){
+        print("Tree:\n");
+        print_tree(&table, table.root_page_num, 0);
+        return(MetaCommand_success);
+    }
+    else{
+        return(MetaCommand_unrecognized);
+    }
+}
+
+global String8 const TOKEN_DELIMITERS = str8_literal(" \t");
+global String8 const SELECT_DELIMITERS = str8_literal(" \t,");
+
+// NOTE: Copies a string column into the fixed size row field, the rest of the field is zeroed so rebinding a
+// shorter value doesn't leave the old tail behind.
+static void
+row_copy_column(char* field, u32 field_size, String8 value){
+    mem_copy(field, value.str, value.size);
+    mem_set(field + value.size, 0, field_size - value.size);
+}
+
+static PrepareResult
+row_set_id(Row* row, String8 value){
+    u64 id = 0;
+    if(value.size > 0 && value.str[0] == '-'){
+        return(PrepareResult_negative_id);
+    }
+    if(!str8_to_u64(value, &id) || id > u32_max){
+        return(PrepareResult_syntax_error);
+    }
+    row->id = (u32)id;
+    return(PrepareResult_success);
+}
+
+static PrepareResult
+row_set_text(Row* row, Column column, String8 value){
+    switch(column){
+        case Column_id:{
+            return(row_set_id(row, value));
+        } break;
+        case Column_username:{
+            if(value.size > USERNAME_SIZE){
+                return(PrepareResult_username_too_long);
+            }
+            row_copy_column(row->username, USERNAME_SIZE, value);
+        } break;
+        case Column_email:{
+            if(value.size > EMAIL_SIZE){
+                return(PrepareResult_email_too_long);
+            }
+            row_copy_column(row->email, EMAIL_SIZE, value);
+        } break;
+        default:{
+            return(PrepareResult_syntax_error);
+        } break;
+    }
+    return(PrepareResult_success);
+}
+
+static PrepareResult
+prepare_insert(String8 rest, Statement* statement){
+    // NOTE: insert id username email, any value can be ? to bind it later.
+    statement->type = StatementType_insert;
+    mem_set(&statement->row, 0, sizeof(statement->row));
+
+    Column fields[] = {Column_id, Column_username, Column_email};
+    for(u32 i=0; i < array_count(fields); ++i){
+        String8 value = str8_next_token(&rest, TOKEN_DELIMITERS);
+        if(value.size == 0){
+            return(PrepareResult_syntax_error);
+        }
+        if(value == str8_literal("?")){
+            statement->param_targets[statement->param_count++] = fields[i];
+            continue;
+        }
+        PrepareResult result = row_set_text(&statement->row, fields[i], value);
+        if(result != PrepareResult_success){
+            return(result);
+        }
+    }
+
+    return(PrepareResult_success);
+}
+
+static Column
+column_from_name(String8 name){
+    if(name == str8_literal("id")){
+        return(Column_id);
+    }
+    if(name == str8_literal("username")){
+        return(Column_username);
+    }
+    if(name == str8_literal("email")){
+        return(Column_email);
+    }
+    return((Column)0);
+}
+
+static CompareOp
+compare_op_from_token(String8 token){
+    if(token == str8_literal("=")){
+        return(CompareOp_eq);
+    }
+    if(token == str8_literal("!=")){
+        return(CompareOp_ne);
+    }
+    if(token == str8_literal("<")){
+        return(CompareOp_lt);
+    }
+    if(token == str8_literal("<=")){
+        return(CompareOp_le);
+    }
+    if(token == str8_literal(">")){
+        return(CompareOp_gt);
+    }
+    if(token == str8_literal(">=")){
+        return(CompareOp_ge);
+    }
+    if(token == str8_literal("like")){
+        return(CompareOp_like);
+    }
+    return(CompareOp_none);
+}
+
+static PrepareResult
+predicate_set_text(Predicate* term, String8 value){
+    if(term->column == Column_id){
+        u64 integer = 0;
+        if(!str8_to_u64(value, &integer) || integer > u32_max){
+            return(PrepareResult_syntax_error);
+        }
+        term->integer = (u32)integer;
+    }
+    else{
+        if(value.size > EMAIL_SIZE){
+            return(PrepareResult_syntax_error);
+        }
+        mem_copy(term->text, value.str, value.size);
+        term->text_size = (u32)value.size;
+    }
+    return(PrepareResult_success);
+}
+
+static PrepareResult
+limit_set_text(Statement* statement, String8 value){
+    u64 limit = 0;
+    if(!str8_to_u64(value, &limit)){
+        return(PrepareResult_syntax_error);
+    }
+    statement->limit = (u32)MIN(limit, (u64)u32_max);
+    return(PrepareResult_success);
+}
+
+static PrepareResult
+prepare_select(String8 rest, Statement* statement){
+    // NOTE: select [id] [username] [email] [where <column> <op> <value> [and <column> <op> <value>]] [limit <n>]
+    // No columns (or *) selects all of them. Tokens are whitespace separated, `id >= 5` not `id>=5`.
+    statement->type = StatementType_select;
+    statement->columns = 0;
+    statement->filter.count = 0;
+    statement->limit = u32_max;
+
+    String8 name = str8_next_token(&rest, SELECT_DELIMITERS);
+    for(; name.size != 0; name = str8_next_token(&rest, SELECT_DELIMITERS)){
+        if(name == str8_literal("where") || name == str8_literal("limit")){
+            break;
+        }
+        if(name == str8_literal("*")){
+            statement->columns |= Column_all;
+            continue;
+        }
+        Column column = column_from_name(name);
+        if(!column){
+            return(PrepareResult_syntax_error);
+        }
+        statement->columns |= column;
+    }
+
+    if(name == str8_literal("where")){
+        Filter* filter = &statement->filter;
+        do{
+            if(filter->count >= FILTER_MAX_TERMS){
+                return(PrepareResult_syntax_error);
+            }
+            u32 term_index = filter->count++;
+            Predicate* term = filter->terms + term_index;
+            term->column = column_from_name(str8_next_token(&rest, TOKEN_DELIMITERS));
+            term->op = compare_op_from_token(str8_next_token(&rest, TOKEN_DELIMITERS));
+            String8 value = str8_next_token(&rest, TOKEN_DELIMITERS);
+            if(!term->column || term->op == CompareOp_none || value.size == 0){
+                return(PrepareResult_syntax_error);
+            }
+            if(term->op == CompareOp_like && term->column == Column_id){
+                return(PrepareResult_syntax_error);
+            }
+            if(value == str8_literal("?")){
+                statement->param_terms[statement->param_count] = term_index;
+                statement->param_targets[statement->param_count++] = ParamTarget_filter;
+            }
+            else if(predicate_set_text(term, value) != PrepareResult_success){
+                return(PrepareResult_syntax_error);
+            }
+            name = str8_next_token(&rest, TOKEN_DELIMITERS);
+        } while(name == str8_literal("and"));
+    }
+
+    if(name == str8_literal("limit")){
+        String8 value = str8_next_token(&rest, TOKEN_DELIMITERS);
+        if(value == str8_literal("?")){
+            statement->param_targets[statement->param_count++] = ParamTarget_limit;
+        }
+        else if(limit_set_text(statement, value) != PrepareResult_success){
+            return(PrepareResult_syntax_error);
+        }
+        name = str8_next_token(&rest, TOKEN_DELIMITERS);
+    }
+
+    if(name.size != 0){
+        return(PrepareResult_syntax_error);
+    }
+    if(statement->columns == 0){
+        statement->columns = Column_all;
+    }
+    return(PrepareResult_success);
+}
+
+// NOTE: Parses input into statement. The input is only read, never modified, and isn't referenced afterwards.
+static PrepareResult
+prepare_statement(String8 input, Statement* statement){
+    PROFILE_BLOCK("parse");
+    statement->param_count = 0;
+    statement->bound = 0;
+
+    String8 rest = input;
+    String8 keyword = str8_next_token(&rest, TOKEN_DELIMITERS);
+    if(keyword == str8_literal("insert")){
+        return(prepare_insert(rest, statement));
+    }
+    if(keyword == str8_literal("select")){
+        return(prepare_select(rest, statement));
+    }
+    return(PrepareResult_unrecognized_statement);
+}
+
+// NOTE: Parameters are numbered from 0 in the order the ?s appear. Binding validates like a literal would,
+// the text versions exist for callers that only have text, bind_u32 skips parsing altogether.
+static PrepareResult
+statement_bind_str8(Statement* statement, u32 index, String8 value){
+    if(index >= statement->param_count){
+        return(PrepareResult_syntax_error);
+    }
+    PrepareResult result;
+    switch(statement->param_targets[index]){
+        case ParamTarget_filter:{
+            result = predicate_set_text(statement->filter.terms + statement->param_terms[index], value);
+        } break;
+        case ParamTarget_limit:{
+            result = limit_set_text(statement, value);
+        } break;
+        default:{
+            result = row_set_text(&statement->row, (Column)statement->param_targets[index], value);
+        } break;
+    }
+    if(result == PrepareResult_success){
+        statement->bound |= (1 << index);
+    }
+    return(result);
+}
+
+static PrepareResult
+statement_bind_u32(Statement* statement, u32 index, u32 value){
+    if(index >= statement->param_count){
+        return(PrepareResult_syntax_error);
+    }
+    switch(statement->param_targets[index]){
+        case ParamTarget_id:{
+            statement->row.id = value;
+        } break;
+        case ParamTarget_limit:{
+            statement->limit = value;
+        } break;
+        case ParamTarget_filter:{
+            Predicate* term = statement->filter.terms + statement->param_terms[index];
+            if(term->column != Column_id){
+                return(PrepareResult_syntax_error);
+            }
+            term->integer = value;
+        } break;
+        default:{
+            return(PrepareResult_syntax_error);
+        } break;
+    }
+    statement->bound |= (1 << index);
+    return(PrepareResult_success);
+}
+
+static bool
+statement_has_param(Statement* statement, ParamTarget target){
+    for(u32 i=0; i < statement->param_count; ++i){
+        if(statement->param_targets[i] == (u32)target){
+            return(true);
+        }
+    }
+    return(false);
+}
+
+static bool
+statement_is_bound(Statement* statement){
+    return(statement->bound == ((1u << statement->param_count) - 1));
+}
+
+static void
+serialize_row(void* dest, Row* row){
+    memcpy((u8*)dest + ID_OFFSET, &row->id, ID_SIZE);
+    memcpy((u8*)dest + USERNAME_OFFSET, row->username, USERNAME_SIZE);
+    memcpy((u8*)dest + EMAIL_OFFSET, row->email, EMAIL_SIZE);
+}
+
+static void
+leaf_node_write_row(void* node, u32 cell_num, u32 key, Row* row){
+    *leaf_node_key(node, cell_num) = key;
+#if LEAF_NODE_PAX
+    memcpy(leaf_node_username(node, cell_num), row->username, USERNAME_SIZE);
+    memcpy(leaf_node_email(node, cell_num), row->email, EMAIL_SIZE);
+#else
+    serialize_row(leaf_node_value(node, cell_num), row);
+#endif
+}
+
+static void
+result_sink_flush_stdout(void*, u8* data, u64 size){
+    PROFILE_BLOCK("output flush");
+    os_write_stdout(data, size);
+}
+
+static void
+result_sink_init(Arena* arena, ResultSink* sink, u64 buffer_size, WriterFlushFunc* flush, void* user){
+    sink->writer = writer_make(arena, buffer_size, flush, user);
+    sink->format = ResultFormat_text;
+    sink->columns = Column_all;
+    sink->rows = 0;
+}
+
+static String8
+column_string(char* str, u32 max_size){
+    // NOTE: Fixed size columns are only null terminated when they're shorter than the column.
+    u8* end = (u8*)memchr(str, 0, max_size);
+    String8 result = str8_range((u8*)str, end ? end : (u8*)str + max_size);
+    return(result);
+}
+
+static void
+result_sink_push_csv_field(Writer* w, String8 field){
+    bool quote = false;
+    for(u64 i=0; i < field.size; ++i){
+        u8 c = field.str[i];
+        if(c == ',' || c == '"' || c == '\n' || c == '\r'){
+            quote = true;
+            break;
+        }
+    }
+    if(!quote){
+        writer_push_str8(w, field);
+        return;
+    }
+
+    // NOTE: Quoted field, embedded quotes are doubled.
+    writer_push_u8(w, '"');
+    u64 run = 0;
+    for(u64 i=0; i < field.size; ++i){
+        if(field.str[i] == '"'){
+            writer_push_bytes(w, field.str + run, i + 1 - run);
+            writer_push_u8(w, '"');
+            run = i + 1;
+        }
+    }
+    writer_push_bytes(w, field.str + run, field.size - run);
+    writer_push_u8(w, '"');
+}
+
+static void
+result_sink_begin(ResultSink* sink, u32 columns){
+    sink->columns = columns;
+    sink->rows = 0;
+    if(sink->format == ResultFormat_csv){
+        Writer* w = &sink->writer;
+        char const* separator = "";
+        if(columns & Column_id){
+            writer_push_str8(w, str8_literal("id"));
+            separator = ",";
+        }
+        if(columns & Column_username){
+            writer_push_str8(w, str8_cstring((u8*)separator));
+            writer_push_str8(w, str8_literal("username"));
+            separator = ",";
+        }
+        if(columns & Column_email){
+            writer_push_str8(w, str8_cstring((u8*)separator));
+            writer_push_str8(w, str8_literal("email"));
+        }
+        writer_push_u8(w, '\n');
+    }
+}
+
+static void
+result_sink_row(ResultSink* sink, void* node, u32 cell_num){
+    // NOTE: Only touches the requested columns, with a PAX leaf the others never get pulled into cache.
+    Writer* w = &sink->writer;
+    u32 columns = sink->columns;
+    sink->rows += 1;
+    switch(sink->format){
+        case ResultFormat_text:{
+            String8 separator = str8_literal("");
+            writer_push_u8(w, '(');
+            if(columns & Column_id){
+                writer_push_u64(w, *leaf_node_id(node, cell_num));
+                separator = str8_literal(", ");
+            }
+            if(columns & Column_username){
+                writer_push_str8(w, separator);
+                writer_push_str8(w, column_string(leaf_node_username(node, cell_num), USERNAME_SIZE));
+                separator = str8_literal(", ");
+            }
+            if(columns & Column_email){
+                writer_push_str8(w, separator);
+                writer_push_str8(w, column_string(leaf_node_email(node, cell_num), EMAIL_SIZE));
+            }
+            writer_push_str8(w, str8_literal(")\n"));
+        } break;
+        case ResultFormat_csv:{
+            bool first = true;
+            if(columns & Column_id){
+                writer_push_u64(w, *leaf_node_id(node, cell_num));
+                first = false;
+            }
+            if(columns & Column_username){
+                if(!first){
+                    writer_push_u8(w, ',');
+                }
+                result_sink_push_csv_field(w, column_string(leaf_node_username(node, cell_num), USERNAME_SIZE));
+                first = false;
+            }
+            if(columns & Column_email){
+                if(!first){
+                    writer_push_u8(w, ',');
+                }
+                result_sink_push_csv_field(w, column_string(leaf_node_email(node, cell_num), EMAIL_SIZE));
+            }
+            writer_push_u8(w, '\n');
+        } break;
+        case ResultFormat_binary:{
+            if(columns & Column_id){
+                writer_push_u32_le(w, *leaf_node_id(node, cell_num));
+            }
+            if(columns & Column_username){
+                String8 username = column_string(leaf_node_username(node, cell_num), USERNAME_SIZE);
+                writer_push_u32_le(w, (u32)username.size);
+                writer_push_str8(w, username);
+            }
+            if(columns & Column_email){
+                String8 email = column_string(leaf_node_email(node, cell_num), EMAIL_SIZE);
+                writer_push_u32_le(w, (u32)email.size);
+                writer_push_str8(w, email);
+            }
+        } break;
+    }
+}
+
+static void
+result_sink_end(ResultSink* sink){
+    writer_flush(&sink->writer);
+}
+
+static u32
+get_unused_page_num(Table* table){
+    return(table->num_pages);
 }
 
 static void
 internal_node_insert(Table* table, u32 parent_page_num, u32 child_page_num){
+    PROFILE_FUNCTION;
     // NOTE: Add a new child/key pair to parent that corresponds to child
 
-    void* parent = get_page(table, parent_page_num);
-    void* child = get_page(table, child_page_num);
-    u32 child_max_key = get_node_max_key(child);
+    PageRef parent_page = get_page(table, parent_page_num);
+    PageRef child_page = get_page(table, child_page_num);
+    void* parent = parent_page.node;
+    mark_page_dirty(table, &parent_page);
+    u32 child_max_key = get_node_max_key(child_page.node);
     u32 index = internal_node_find_child(parent, child_max_key);
+    release_page(table, &child_page);
 
     u32 original_num_keys = *internal_node_num_keys(parent);
     *internal_node_num_keys(parent) = original_num_keys + 1;
@@ -660,36 +1933,46 @@ internal_node_insert(Table* table, u32 parent_page_num, u32 child_page_num){
     }
 
     u32 right_child_page_num = *internal_node_right_child(parent);
-    void* right_child = get_page(table, right_child_page_num);
+    PageRef right_child = get_page(table, right_child_page_num);
+    u32 right_child_max_key = get_node_max_key(right_child.node);
+    release_page(table, &right_child);
 
-    if(child_max_key > get_node_max_key(right_child)){
+    if(child_max_key > right_child_max_key){
         // NOTE: Replace right child
         *internal_node_child(parent, original_num_keys) = right_child_page_num;
-        *internal_node_key(parent, original_num_keys) = get_node_max_key(right_child);
+        *internal_node_key(parent, original_num_keys) = right_child_max_key;
         *internal_node_right_child(parent) = child_page_num;
     }
     else{
-        for(u32 i=original_num_keys; i > index; --i){
-            void* dest = internal_node_cell(parent, i);
-            void* source = internal_node_cell(parent, i - 1);
-            memcpy(dest, source, INTERNAL_NODE_CELL_SIZE);
-        }
+        // NOTE: Make room for the new cell, keys and children are shifted separately.
+        u32 move_count = original_num_keys - index;
+        memmove(internal_node_key(parent, index + 1), internal_node_key(parent, index), move_count * INTERNAL_NODE_KEY_SIZE);
+        memmove(internal_node_children(parent) + index + 1, internal_node_children(parent) + index, move_count * INTERNAL_NODE_CHILD_SIZE);
+        *internal_node_child(parent, index) = child_page_num;
+        *internal_node_key(parent, index) = child_max_key;
     }
-    *internal_node_child(parent, index) = child_page_num;
-    *internal_node_key(parent, index) = child_max_key;
+    release_page(table, &parent_page);
 }
 
 static void
 create_new_root(Table* table, u32 right_child_page_num){
+    PROFILE_FUNCTION;
     // NOTE: Handle splitting the root.
     // Old root copied to new page, becomes left child.
     // Address of rigth child passed in.
     // Re-initialize root page to contain the new root node.
     // New root node points to two children.
-    void* root = get_page(table, table->root_page_num)->base;
-    void* right_child = get_page(table, right_child_page_num)->base;
+    table->counters.root_splits += 1;
+    PageRef root_page = get_page(table, table->root_page_num);
+    PageRef right_child_page = get_page(table, right_child_page_num);
     u32 left_child_page_num = get_unused_page_num(table);
-    void* left_child = get_page(table, left_child_page_num)->base;
+    PageRef left_child_page = get_page(table, left_child_page_num);
+    mark_page_dirty(table, &root_page);
+    mark_page_dirty(table, &right_child_page);
+    mark_page_dirty(table, &left_child_page);
+    void* root = root_page.node;
+    void* right_child = right_child_page.node;
+    void* left_child = left_child_page.node;
 
     // NOTE: Left child has data copies from old root.
     memcpy(left_child, root, PAGE_SIZE);
@@ -705,17 +1988,26 @@ create_new_root(Table* table, u32 right_child_page_num){
     *internal_node_right_child(root) = right_child_page_num;
     *node_parent(left_child) = table->root_page_num;
     *node_parent(right_child) = table->root_page_num;
+
+    release_page(table, &left_child_page);
+    release_page(table, &right_child_page);
+    release_page(table, &root_page);
 }
 
 static void
 leaf_node_split_and_insert(Cursor* c, u32 key, Row* row){
+    PROFILE_FUNCTION;
     // NOTE: Create a new node and move half the cells over.
     // Insert the value in one of the two noes.
     // Update parent or create a new parent.
-    void* old_node = get_page(c->table, c->page_num)->base;
+    c->table->counters.leaf_splits += 1;
+    void* old_node = c->leaf.node;
     u32 old_max = get_node_max_key(old_node);
     u32 new_page_num = get_unused_page_num(c->table);
-    void* new_node = get_page(c->table, new_page_num)->base;
+    PageRef new_page = get_page(c->table, new_page_num);
+    void* new_node = new_page.node;
+    mark_page_dirty(c->table, &c->leaf);
+    mark_page_dirty(c->table, &new_page);
     init_leaf_node(new_node);
     *node_parent(new_node) = *node_parent(old_node);
     *leaf_node_next_leaf(new_node) = *leaf_node_next_leaf(old_node);
@@ -732,24 +2024,22 @@ leaf_node_split_and_insert(Cursor* c, u32 key, Row* row){
             dest_node = old_node;
         }
         u32 index_within_node = i % LEAF_NODE_LEFT_SPLIT_COUNT;
-        void* cell = leaf_node_cell(dest_node, index_within_node);
 
         if(i == c->cell_num){
-            *leaf_node_key(dest_node, index_within_node) = key;
-            serialize_row(leaf_node_value(dest_node, index_within_node), row);
-            //serialize_row(cell, row);
+            leaf_node_write_row(dest_node, index_within_node, key, row);
         }
         else if(i > c->cell_num){
-            memcpy(cell, leaf_node_cell(old_node, i-1), LEAF_NODE_CELL_SIZE);
+            leaf_node_move_cells(dest_node, index_within_node, old_node, i-1, 1);
         }
         else{
-            memcpy(cell, leaf_node_cell(old_node, i), LEAF_NODE_CELL_SIZE);
+            leaf_node_move_cells(dest_node, index_within_node, old_node, i, 1);
         }
     }
 
     // NOTE: Update cell count on both leaf nodes.
     *(leaf_node_num_cells(old_node)) = LEAF_NODE_LEFT_SPLIT_COUNT;
     *(leaf_node_num_cells(new_node)) = LEAF_NODE_RIGHT_SPLIT_COUNT;
+    release_page(c->table, &new_page);
 
     // NOTE: Update nodes' parent.
     if(is_node_root(old_node)){
@@ -760,9 +2050,11 @@ leaf_node_split_and_insert(Cursor* c, u32 key, Row* row){
         //exit(EXIT_FAILURE);
         u32 parent_page_num = *node_parent(old_node);
         u32 new_max = get_node_max_key(old_node);
-        void* parent = get_page(c->table, parent_page_num)->base;
+        PageRef parent = get_page(c->table, parent_page_num);
+        mark_page_dirty(c->table, &parent);
 
-        update_internal_node_key(parent, old_max, new_max);
+        update_internal_node_key(parent.node, old_max, new_max);
+        release_page(c->table, &parent);
         internal_node_insert(c->table, parent_page_num, new_page_num);
         return;
     }
@@ -770,7 +2062,7 @@ leaf_node_split_and_insert(Cursor* c, u32 key, Row* row){
 
 static void
 leaf_node_insert(Cursor* c, u32 key, Row* row){
-    void* node = get_page(c->table, c->page_num)->base;
+    void* node = c->leaf.node;
     u32 num_cells = *leaf_node_num_cells(node);
     if(num_cells >= LEAF_NODE_MAX_CELLS){
         leaf_node_split_and_insert(c, key, row);
@@ -779,129 +2071,2008 @@ leaf_node_insert(Cursor* c, u32 key, Row* row){
         //exit(EXIT_FAILURE);
     }
 
+    mark_page_dirty(c->table, &c->leaf);
     if(c->cell_num < num_cells){
-        for(s32 i=num_cells; i > c->cell_num; --i){
-            memcpy(leaf_node_cell(node, i), leaf_node_cell(node, i - 1), LEAF_NODE_CELL_SIZE);
-        }
+        leaf_node_move_cells(node, c->cell_num + 1, node, c->cell_num, num_cells - c->cell_num);
     }
 
     *(leaf_node_num_cells(node)) += 1;
-    *(leaf_node_key(node, c->cell_num)) = key;
-    serialize_row(leaf_node_value(node, c->cell_num), row);
+    leaf_node_write_row(node, c->cell_num, key, row);
 }
 
 static ExecuteResult
-execute_insert(Table* table, Statement* statement){
-    Arena* node = get_page(table, table->root_page_num);
-    u32 num_cells = *leaf_node_num_cells(node->base);
-    //if(num_cells >= LEAF_NODE_MAX_CELLS){
-    //    return(ExecuteResult_table_full);
-    //}
-
-    Row* row = &statement->row;
+execute_insert(Table* table, Row* row){
     u32 id = row->id;
-    Cursor* c = cursor_find(table, id);
+    Cursor c = cursor_find(table, id);
 
-    if(c->cell_num < num_cells){
-        u32 current_id = *leaf_node_key(node->base, c->cell_num);
-        if(id == current_id){
-            return(ExecuteResult_duplicate_key);
-        }
+    // NOTE: The duplicate check has to look at the leaf the cursor landed in, not the root.
+    ExecuteResult result = ExecuteResult_success;
+    void* node = cursor_node(&c);
+    u32 num_cells = *leaf_node_num_cells(node);
+    if(c.cell_num < num_cells && *leaf_node_key(node, c.cell_num) == id){
+        result = ExecuteResult_duplicate_key;
+    }
+    else{
+        leaf_node_insert(&c, id, row);
     }
-    leaf_node_insert(c, id, row);
-    return(ExecuteResult_success);
+    cursor_close(&c);
+    return(result);
 }
 
-static ExecuteResult
-execute_select(Table* table, Statement* statement){
-    Cursor* cursor = cursor_start(table);
+///////////////////////////////
+// NOTE: Scan Kernels
+///////////////////////////////
+// NOTE: A select evaluates its where clause a leaf at a time. A kernel tests a range of cells of one leaf and
+// writes the indices of the ones that pass to a selection vector, the VM then emits those rows in one go.
+// Kernels are scan_leaf() instantiated per predicate shape, so the column, its size and the kind of match are
+// compile time constants and the per cell test inlines down to a memcmp, there's no interpreter in the loop.
+//     id range (=, <, <=, >, >=)      no per cell test at all: keys are sorted, the range becomes a seek plus an
+//                                     end cell found by binary search in the last leaf
+//     text = / like x% / %x / %x%     MatchText<column, match>
+//     id range and one text term      the text kernel over the id range
+// Anything else (id !=, text <, two text terms) runs MatchFilter, which interprets the terms per cell. The shape
+// is picked once per execution by scan_init(), after the parameters are bound, a `like ?` can change shape
+// between bindings.
+
+typedef enum TextMatch{
+    TextMatch_equal,
+    TextMatch_prefix,
+    TextMatch_suffix,
+    TextMatch_contains,
+    TextMatch_COUNT,
+} TextMatch;
+
+static TextMatch
+predicate_text_match(Predicate* term, String8* needle){
+    // NOTE: Only like has wildcards, what's left between them is the needle.
+    String8 text = str8((u8*)term->text, term->text_size);
+    TextMatch result = TextMatch_equal;
+    if(term->op == CompareOp_like){
+        bool leading = (text.size > 0 && text.str[0] == '%');
+        bool trailing = (text.size > (u64)leading && text.str[text.size - 1] == '%');
+        if(leading){
+            text.str += 1;
+            text.size -= 1;
+        }
+        if(trailing){
+            text.size -= 1;
+        }
+        if(leading && trailing){
+            result = TextMatch_contains;
+        }
+        else if(leading){
+            result = TextMatch_suffix;
+        }
+        else if(trailing){
+            result = TextMatch_prefix;
+        }
+    }
+    *needle = text;
+    return(result);
+}
 
-    Row* at;
-    while(!(cursor->end_of_table)){
-        at = cursor_at(cursor);
-        deserialize_row(at);
-        cursor_next(cursor);
+static bool
+text_match(TextMatch match, char* field, u32 field_size, String8 needle){
+    // NOTE: field is a fixed size column, only null terminated when it's shorter than field_size.
+    switch(match){
+        case TextMatch_equal:{
+            return(needle.size <= field_size && memcmp(field, needle.str, needle.size) == 0 &&
+                   (needle.size == field_size || field[needle.size] == 0));
+        } break;
+        case TextMatch_prefix:{
+            return(needle.size <= field_size && memcmp(field, needle.str, needle.size) == 0);
+        } break;
+        case TextMatch_suffix:{
+            return(str8_ends_with(column_string(field, field_size), needle));
+        } break;
+        case TextMatch_contains:{
+            return(str8_contains(column_string(field, field_size), needle));
+        } break;
+        default: break;
     }
-    return(ExecuteResult_success);
+    return(false);
 }
 
-static ExecuteResult
-execute_statement(Table* table, Statement* statement){
-    ExecuteResult result;
+static bool
+predicate_match(Predicate* term, void* node, u32 cell_num){
+    if(term->column == Column_id){
+        u32 id = *leaf_node_id(node, cell_num);
+        switch(term->op){
+            case CompareOp_eq: return(id == term->integer);
+            case CompareOp_ne: return(id != term->integer);
+            case CompareOp_lt: return(id <  term->integer);
+            case CompareOp_le: return(id <= term->integer);
+            case CompareOp_gt: return(id >  term->integer);
+            case CompareOp_ge: return(id >= term->integer);
+            default: break;
+        }
+        return(false);
+    }
+
+    bool username = (term->column == Column_username);
+    char* field = username ? leaf_node_username(node, cell_num) : leaf_node_email(node, cell_num);
+    u32 field_size = username ? USERNAME_SIZE : EMAIL_SIZE;
+    if(term->op == CompareOp_eq || term->op == CompareOp_like){
+        String8 needle;
+        TextMatch match = predicate_text_match(term, &needle);
+        return(text_match(match, field, field_size, needle));
+    }
+
+    String8 value = column_string(field, field_size);
+    u64 size = MIN(value.size, (u64)term->text_size);
+    s32 order = memcmp(value.str, term->text, size);
+    if(order == 0){
+        order = (value.size > term->text_size) - (value.size < term->text_size);
+    }
+    switch(term->op){
+        case CompareOp_ne: return(order != 0);
+        case CompareOp_lt: return(order <  0);
+        case CompareOp_le: return(order <= 0);
+        case CompareOp_gt: return(order >  0);
+        case CompareOp_ge: return(order >= 0);
+        default: break;
+    }
+    return(false);
+}
+
+typedef struct ScanArgs{
+    Filter* filter;
+    String8 needle; // NOTE: of the one text term, for MatchText
+} ScanArgs;
+
+struct MatchAll{
+    MatchAll(ScanArgs*){}
+    bool operator()(void*, u32) const{ return(true); }
+};
+
+template<u32 column, TextMatch match>
+struct MatchText{
+    String8 needle;
+    MatchText(ScanArgs* args) : needle(args->needle){}
+    bool
+    operator()(void* node, u32 cell_num) const{
+        if(column == Column_username){
+            return(text_match(match, leaf_node_username(node, cell_num), USERNAME_SIZE, needle));
+        }
+        return(text_match(match, leaf_node_email(node, cell_num), EMAIL_SIZE, needle));
+    }
+};
+
+struct MatchFilter{
+    Filter* filter;
+    MatchFilter(ScanArgs* args) : filter(args->filter){}
+    bool
+    operator()(void* node, u32 cell_num) const{
+        for(u32 i=0; i < filter->count; ++i){
+            if(!predicate_match(filter->terms + i, node, cell_num)){
+                return(false);
+            }
+        }
+        return(true);
+    }
+};
+
+// NOTE: Appends the cells in [begin, end) that pass to selection, returns how many did. The store is unconditional
+// and only the count depends on the test, so the loop doesn't branch on it.
+template<typename Match>
+static u32
+scan_leaf(void* node, u32 begin, u32 end, ScanArgs* args, u16* selection){
+    Match match(args);
+    u32 count = 0;
+    for(u32 cell_num=begin; cell_num < end; ++cell_num){
+        selection[count] = (u16)cell_num;
+        count += match(node, cell_num);
+    }
+    return(count);
+}
+
+typedef u32 ScanKernel(void* node, u32 begin, u32 end, ScanArgs* args, u16* selection);
+
+// NOTE: [0] username, [1] email.
+global ScanKernel* text_scan_kernels[2][TextMatch_COUNT] = {
+    {
+        scan_leaf<MatchText<Column_username, TextMatch_equal>>,
+        scan_leaf<MatchText<Column_username, TextMatch_prefix>>,
+        scan_leaf<MatchText<Column_username, TextMatch_suffix>>,
+        scan_leaf<MatchText<Column_username, TextMatch_contains>>,
+    },
+    {
+        scan_leaf<MatchText<Column_email, TextMatch_equal>>,
+        scan_leaf<MatchText<Column_email, TextMatch_prefix>>,
+        scan_leaf<MatchText<Column_email, TextMatch_suffix>>,
+        scan_leaf<MatchText<Column_email, TextMatch_contains>>,
+    },
+};
+
+#define SCAN_SELECTION_MAX 512 // NOTE: more cells than a leaf holds
+
+typedef struct Scan{
+    ScanKernel* kernel;
+    ScanArgs args;
+    u32 id_min;
+    u32 id_max;
+    bool done; // NOTE: the scan reached id_max, nothing further along can match
+    u32 count;
+    u16 selection[SCAN_SELECTION_MAX];
+} Scan;
+
+// NOTE: Picks the kernel for the filter's shape and folds the id terms into [id_min, id_max]. Returns false when
+// no id can satisfy them.
+static bool
+scan_init(Scan* scan, Filter* filter){
+    scan->id_min = 0;
+    scan->id_max = u32_max;
+    scan->done = false;
+    scan->count = 0;
+    scan->args.filter = filter;
+    scan->args.needle = str8(0, 0);
+
+    Predicate* text_term = 0;
+    bool generic = false;
+    for(u32 i=0; i < filter->count; ++i){
+        Predicate* term = filter->terms + i;
+        if(term->column == Column_id){
+            u32 value = term->integer;
+            switch(term->op){
+                case CompareOp_eq:{
+                    scan->id_min = MAX(scan->id_min, value);
+                    scan->id_max = MIN(scan->id_max, value);
+                } break;
+                case CompareOp_lt:{
+                    if(value == 0){
+                        return(false);
+                    }
+                    scan->id_max = MIN(scan->id_max, value - 1);
+                } break;
+                case CompareOp_le:{
+                    scan->id_max = MIN(scan->id_max, value);
+                } break;
+                case CompareOp_gt:{
+                    if(value == u32_max){
+                        return(false);
+                    }
+                    scan->id_min = MAX(scan->id_min, value + 1);
+                } break;
+                case CompareOp_ge:{
+                    scan->id_min = MAX(scan->id_min, value);
+                } break;
+                default:{
+                    generic = true;
+                } break;
+            }
+        }
+        else if((term->op == CompareOp_eq || term->op == CompareOp_like) && !text_term){
+            text_term = term;
+        }
+        else{
+            generic = true;
+        }
+    }
+    if(scan->id_min > scan->id_max){
+        return(false);
+    }
+
+    if(generic){
+        scan->kernel = scan_leaf<MatchFilter>;
+    }
+    else if(text_term){
+        TextMatch match = predicate_text_match(text_term, &scan->args.needle);
+        scan->kernel = text_scan_kernels[text_term->column == Column_email][match];
+    }
+    else{
+        scan->kernel = scan_leaf<MatchAll>;
+    }
+    return(true);
+}
+
+///////////////////////////////
+// NOTE: Bytecode VM
+///////////////////////////////
+// NOTE: Statements are compiled to a short register based program and run by one dispatch loop, the same idea
+// as sqlite's VDBE. Jumps are instruction indices. Values (filter, limit, the inserted row) are loaded from the
+// statement when the program runs, not baked into it, so one program serves every binding of its statement.
+// A select runs a leaf per loop iteration, the filter is evaluated by a scan kernel (see Scan Kernels):
+//
+//     result_begin          columns
+//     scan_open             -> end         (seeks to the filter's lowest id, rewinds without one)
+//     limit        r0                      (only with a limit)
+//     if_zero      r0       -> end
+//   loop:
+//     scan_leaf             -> next        (leaf has no matching rows)
+//     result_rows  r0       -> end         (limit used up)
+//   next:
+//     next_leaf             -> loop
+//   end:
+//     close
+//     result_end
+//     halt
+
+typedef enum OpCode{
+    OpCode_halt,
+    OpCode_goto,          // NOTE: pc = p3
+    OpCode_integer,       // NOTE: r[p1] = p3
+    OpCode_limit,         // NOTE: r[p1] = the statement's limit
+    OpCode_if_zero,       // NOTE: pc = p3 if r[p1] is 0
+    OpCode_scan_open,     // NOTE: set up the statement's filter, cursor on its first candidate row, pc = p3 if none
+    OpCode_scan_leaf,     // NOTE: select the matching rows from the cursor to the end of its leaf, pc = p3 if none
+    OpCode_next_leaf,     // NOTE: cursor to the start of the next leaf, pc = p3 if there is one and the scan goes on
+    OpCode_close,         // NOTE: release the cursor
+    OpCode_result_begin,  // NOTE: start a result set with columns p3
+    OpCode_result_rows,   // NOTE: write the selected rows to the result sink. p2 set: at most r[p1] of them, r[p1] is
+                          // decremented by the rows written, pc = p3 once it hits 0
+    OpCode_result_end,    // NOTE: flush the result sink
+    OpCode_insert,        // NOTE: insert the statement's row
+    OpCode_COUNT,
+} OpCode;
+
+typedef struct Instruction{
+    u8 op;
+    u8 p1;
+    u16 p2;
+    u32 p3;
+} Instruction;
+
+typedef enum RegisterType{
+    RegisterType_null,
+    RegisterType_integer,
+} RegisterType;
+
+typedef struct Register{
+    RegisterType type;
+    u32 integer;
+} Register;
+
+#define PROGRAM_MAX_INSTRUCTIONS 32
+#define PROGRAM_MAX_REGISTERS 4
+
+typedef struct Program{
+    Instruction code[PROGRAM_MAX_INSTRUCTIONS];
+    u32 count;
+    Register registers[PROGRAM_MAX_REGISTERS];
+    Statement* statement;
+} Program;
+
+static u32
+program_emit(Program* program, OpCode op, u32 p1, u32 p2, u32 p3){
+    assert(program->count < PROGRAM_MAX_INSTRUCTIONS);
+    u32 index = program->count++;
+    Instruction* in = program->code + index;
+    in->op = (u8)op;
+    in->p1 = (u8)p1;
+    in->p2 = (u16)p2;
+    in->p3 = p3;
+    return(index);
+}
+
+// NOTE: Forward jumps are emitted with a 0 target and patched once the label's address is known.
+static void
+program_patch_jump(Program* program, u32 index, u32 target){
+    program->code[index].p3 = target;
+}
+
+static void
+compile_select(Statement* statement, Program* program){
+    enum{ reg_limit = 0 };
+    bool has_limit = (statement->limit != u32_max || statement_has_param(statement, ParamTarget_limit));
+
+    program_emit(program, OpCode_result_begin, 0, 0, statement->columns);
+    u32 open_jump = program_emit(program, OpCode_scan_open, 0, 0, 0);
+    u32 limit_zero_jump = u32_max;
+    if(has_limit){
+        program_emit(program, OpCode_limit, reg_limit, 0, 0);
+        limit_zero_jump = program_emit(program, OpCode_if_zero, reg_limit, 0, 0);
+    }
+
+    u32 loop = program_emit(program, OpCode_scan_leaf, 0, 0, 0);
+    u32 limit_jump = program_emit(program, OpCode_result_rows, reg_limit, has_limit, 0);
+    u32 next = program_emit(program, OpCode_next_leaf, 0, 0, loop);
+    u32 end = program->count;
+    program_emit(program, OpCode_close, 0, 0, 0);
+    program_emit(program, OpCode_result_end, 0, 0, 0);
+    program_emit(program, OpCode_halt, 0, 0, 0);
+
+    program_patch_jump(program, open_jump, end);
+    if(limit_zero_jump != u32_max){
+        program_patch_jump(program, limit_zero_jump, end);
+    }
+    program_patch_jump(program, loop, next);
+    program_patch_jump(program, limit_jump, end);
+}
+
+static void
+compile_statement(Statement* statement, Program* program){
+    PROFILE_BLOCK("compile");
+    program->count = 0;
+    program->statement = statement;
     switch(statement->type){
         case StatementType_insert:{
-            result = execute_insert(table, statement);
+            program_emit(program, OpCode_insert, 0, 0, 0);
+            program_emit(program, OpCode_halt, 0, 0, 0);
         } break;
         case StatementType_select:{
-            result = execute_select(table, statement);
+            compile_select(statement, program);
         } break;
     }
-    return(result);
+}
+
+// NOTE: One run of a program. With a sink, vm_run() goes from start to halt and rows go to the sink. Without one
+// the rows are handed back one at a time: vm_run() returns VMStatus_row with the row in row_node/row_cell, the
+// leaf stays pinned until the next vm_run(), calling it again carries on with the next row.
+typedef enum VMStatus{
+    VMStatus_halt,
+    VMStatus_row,
+} VMStatus;
+
+// NOTE: What a run did, only counted for a VM that has one (explain analyze).
+typedef struct VMStats{
+    u64 leaves;
+    u64 rows_examined; // NOTE: cells handed to the scan kernel
+    u64 rows_returned;
+    u64 output_ticks;  // NOTE: cpu timer ticks spent writing rows into the sink
+} VMStats;
+
+typedef struct VM{
+    Table* table;
+    Program* program;
+    ResultSink* sink;
+    VMStats* stats;
+    u32 pc;
+    Cursor cursor;
+    Scan scan;
+    u32 emitted; // NOTE: rows of the current selection handed back so far, sinkless runs only
+    void* row_node;
+    u32 row_cell;
+    ExecuteResult result;
+} VM;
+
+static void
+vm_init(VM* vm, Table* table, Program* program, ResultSink* sink){
+    vm->table = table;
+    vm->program = program;
+    vm->sink = sink;
+    vm->stats = 0;
+    vm->pc = 0;
+    vm->cursor = ZERO_INIT;
+    vm->cursor.table = table;
+    vm->cursor.end_of_table = true;
+    vm->emitted = 0;
+    vm->row_node = 0;
+    vm->row_cell = 0;
+    vm->result = ExecuteResult_success;
+}
+
+static VMStatus
+vm_run(VM* vm){
+    PROFILE_BLOCK("execute");
+    Table* table = vm->table;
+    Program* program = vm->program;
+    ResultSink* sink = vm->sink;
+    Register* r = program->registers;
+    Cursor* cursor = &vm->cursor;
+    Scan* scan = &vm->scan;
+
+    u32 pc = vm->pc;
+    for(;;){
+        Instruction* in = program->code + pc++;
+        switch(in->op){
+            case OpCode_halt:{
+                vm->pc = pc - 1;
+                if(table->io_failed){
+                    vm->result = ExecuteResult_io_error;
+                }
+                return(VMStatus_halt);
+            } break;
+            case OpCode_goto:{
+                pc = in->p3;
+            } break;
+            case OpCode_integer:{
+                r[in->p1].type = RegisterType_integer;
+                r[in->p1].integer = in->p3;
+            } break;
+            case OpCode_limit:{
+                r[in->p1].type = RegisterType_integer;
+                r[in->p1].integer = program->statement->limit;
+            } break;
+            case OpCode_if_zero:{
+                if(r[in->p1].integer == 0){
+                    pc = in->p3;
+                }
+            } break;
+            case OpCode_scan_open:{
+                if(!scan_init(scan, &program->statement->filter)){
+                    pc = in->p3;
+                    break;
+                }
+                *cursor = (scan->id_min == 0) ? cursor_begin(table) : cursor_seek(table, scan->id_min);
+                if(!cursor_valid(cursor)){
+                    pc = in->p3;
+                }
+            } break;
+            case OpCode_scan_leaf:{
+                // NOTE: The kernel reads the leaf's cells directly, the cursor only moves a leaf at a time, through
+                // cursor_next_leaf in OpCode_next_leaf.
+                void* node = cursor_node(cursor);
+                u32 begin = cursor->cell_num;
+                u32 end = *leaf_node_num_cells(node);
+                assert(end <= SCAN_SELECTION_MAX);
+                // NOTE: Keys are sorted, the upper bound on id cuts the cell range instead of being tested per cell.
+                if(*leaf_node_key(node, end - 1) > scan->id_max){
+                    end = leaf_node_upper_bound(node, begin, end, scan->id_max);
+                    scan->done = true;
+                }
+                scan->count = scan->kernel(node, begin, end, &scan->args, scan->selection);
+                if(vm->stats){
+                    vm->stats->leaves += 1;
+                    vm->stats->rows_examined += end - begin;
+                }
+                if(scan->count == 0){
+                    pc = in->p3;
+                }
+            } break;
+            case OpCode_next_leaf:{
+                if(scan->done){
+                    break;
+                }
+                cursor_next_leaf(cursor);
+                if(cursor_valid(cursor)){
+                    pc = in->p3;
+                }
+            } break;
+            case OpCode_close:{
+                cursor_close(cursor);
+            } break;
+            case OpCode_result_begin:{
+                if(sink){
+                    result_sink_begin(sink, in->p3);
+                }
+            } break;
+            case OpCode_result_rows:{
+                void* node = cursor_node(cursor);
+                u32 count = scan->count;
+                if(in->p2){
+                    count = MIN(count, r[in->p1].integer);
+                }
+                if(vm->stats){
+                    vm->stats->rows_returned += count;
+                }
+                if(!sink){
+                    // NOTE: Hand back one row and come back to this instruction for the next.
+                    if(vm->emitted < count){
+                        vm->row_node = node;
+                        vm->row_cell = scan->selection[vm->emitted++];
+                        vm->pc = pc - 1;
+                        return(VMStatus_row);
+                    }
+                    vm->emitted = 0;
+                }
+                else{
+                    PROFILE_BLOCK("output rows");
+                    u64 output_begin = vm->stats ? read_cpu_timer() : 0;
+                    for(u32 i=0; i < count; ++i){
+                        result_sink_row(sink, node, scan->selection[i]);
+                    }
+                    if(vm->stats){
+                        vm->stats->output_ticks += read_cpu_timer() - output_begin;
+                    }
+                }
+                if(in->p2){
+                    r[in->p1].integer -= count;
+                    if(r[in->p1].integer == 0){
+                        pc = in->p3;
+                    }
+                }
+            } break;
+            case OpCode_result_end:{
+                if(sink){
+                    u64 output_begin = vm->stats ? read_cpu_timer() : 0;
+                    result_sink_end(sink);
+                    if(vm->stats){
+                        vm->stats->output_ticks += read_cpu_timer() - output_begin;
+                    }
+                }
+            } break;
+            case OpCode_insert:{
+                vm->result = execute_insert(table, &program->statement->row);
+            } break;
+            default:{
+                assert(!"bad opcode");
+            } break;
+        }
+    }
+}
+
+static ExecuteResult
+vm_execute(Table* table, Program* program, ResultSink* sink){
+    u64 begin = read_cpu_timer();
+    VM vm;
+    vm_init(&vm, table, program, sink);
+    vm_run(&vm);
+    histogram_record(statement_latency + statement_kind(program->statement), read_cpu_timer() - begin);
+    return(vm.result);
+}
+
+///////////////////////////////
+// NOTE: Plan Cache
+///////////////////////////////
+// NOTE: Compiled statements keyed by their normalized text: tokens joined by single spaces with every value
+// lifted out to a ?, so `insert 1 a b` and `insert 2 c d` share the plan for `insert ? ? ?`. A hit goes from
+// text to execution with one tokenizing pass, a hash lookup and the binds, no prepare and no compile.
+// Entries are recycled least recently used first. An entry compiled under an older Table::schema_version is
+// treated as a miss and recompiled.
+#define PLAN_CACHE_SIZE 64
+#define PLAN_CACHE_BUCKET_COUNT 128 // NOTE: power of 2
+#define PLAN_KEY_MAX 256
+#define PLAN_NONE u32_max
+
+typedef struct PlanEntry{
+    u64 hash;
+    u32 key_size;
+    u8 key[PLAN_KEY_MAX];
+    u32 schema_version;
+    u32 next_in_bucket;
+    u32 lru_prev; // NOTE: towards more recently used
+    u32 lru_next;
+    Statement statement;
+    Program program;
+} PlanEntry;
+
+typedef struct PlanCache{
+    PlanEntry entries[PLAN_CACHE_SIZE];
+    u32 buckets[PLAN_CACHE_BUCKET_COUNT];
+    u32 count;
+    u32 lru_head; // NOTE: most recently used
+    u32 lru_tail;
+    u64 hits;
+    u64 misses;
+} PlanCache;
+global PlanCache plan_cache;
+
+// NOTE: One lifted value. str == 0 marks a ? that was already in the text, it stays unbound.
+typedef struct PlanLiteral{
+    String8 value;
+} PlanLiteral;
+
+static void
+plan_cache_init(PlanCache* cache){
+    cache->count = 0;
+    cache->lru_head = PLAN_NONE;
+    cache->lru_tail = PLAN_NONE;
+    cache->hits = 0;
+    cache->misses = 0;
+    for(u32 i=0; i < PLAN_CACHE_BUCKET_COUNT; ++i){
+        cache->buckets[i] = PLAN_NONE;
+    }
+}
+
+// NOTE: Writes the normalized text into key and the lifted values into literals. Returns false if the
+// statement doesn't fit the cache (key too long, too many values), the caller prepares it directly then.
+static bool
+plan_normalize(String8 input, u8* key, u32* key_size, PlanLiteral* literals, u32* literal_count){
+    u32 size = 0;
+    u32 count = 0;
+    String8 rest = input;
+    String8 keyword = str8_next_token(&rest, TOKEN_DELIMITERS);
+    bool insert = (keyword == str8_literal("insert"));
+    bool select = (keyword == str8_literal("select"));
+
+    // NOTE: Which upcoming tokens are values. insert: the three after the keyword. select: the third token after
+    // where or a where's and, the one after limit.
+    u32 value_tokens = insert ? 3 : 0;
+    u32 where_position = 0;
+    bool in_where = false;
+    u32 token_index = 0;
+    for(String8 token = keyword; token.size != 0; token = str8_next_token(&rest, TOKEN_DELIMITERS), ++token_index){
+        bool is_value = false;
+        if(insert && token_index >= 1 && token_index <= value_tokens){
+            is_value = true;
+        }
+        if(select){
+            if(where_position){
+                where_position += 1;
+                if(where_position == 4){
+                    is_value = true;
+                    where_position = 0;
+                }
+            }
+            else if(token == str8_literal("where") || (in_where && token == str8_literal("and"))){
+                where_position = 1;
+                in_where = true;
+            }
+        }
+
+        String8 out = token;
+        if(is_value){
+            if(count >= STATEMENT_MAX_PARAMS){
+                return(false);
+            }
+            literals[count].value = (token == str8_literal("?")) ? str8(0, 0) : token;
+            count += 1;
+            out = str8_literal("?");
+        }
+        if(size + out.size + 1 > PLAN_KEY_MAX){
+            return(false);
+        }
+        if(size){
+            key[size++] = ' ';
+        }
+        mem_copy(key + size, out.str, out.size);
+        size += (u32)out.size;
+
+        // NOTE: A value spelled limit is only a value, `where username = limit limit 5` has one limit clause.
+        if(select && !is_value && token == str8_literal("limit")){
+            String8 value = str8_next_token(&rest, TOKEN_DELIMITERS);
+            if(value.size == 0 || count >= STATEMENT_MAX_PARAMS || size + 2 > PLAN_KEY_MAX){
+                return(false);
+            }
+            literals[count].value = (value == str8_literal("?")) ? str8(0, 0) : value;
+            count += 1;
+            key[size++] = ' ';
+            key[size++] = '?';
+            token_index += 1;
+        }
+    }
+    *key_size = size;
+    *literal_count = count;
+    return(true);
+}
+
+static void
+plan_lru_unlink(PlanCache* cache, u32 index){
+    PlanEntry* entry = cache->entries + index;
+    if(entry->lru_prev != PLAN_NONE){
+        cache->entries[entry->lru_prev].lru_next = entry->lru_next;
+    }
+    else{
+        cache->lru_head = entry->lru_next;
+    }
+    if(entry->lru_next != PLAN_NONE){
+        cache->entries[entry->lru_next].lru_prev = entry->lru_prev;
+    }
+    else{
+        cache->lru_tail = entry->lru_prev;
+    }
+}
+
+static void
+plan_lru_push_front(PlanCache* cache, u32 index){
+    PlanEntry* entry = cache->entries + index;
+    entry->lru_prev = PLAN_NONE;
+    entry->lru_next = cache->lru_head;
+    if(cache->lru_head != PLAN_NONE){
+        cache->entries[cache->lru_head].lru_prev = index;
+    }
+    cache->lru_head = index;
+    if(cache->lru_tail == PLAN_NONE){
+        cache->lru_tail = index;
+    }
+}
+
+static void
+plan_bucket_unlink(PlanCache* cache, u32 index){
+    u32* link = cache->buckets + (cache->entries[index].hash & (PLAN_CACHE_BUCKET_COUNT - 1));
+    while(*link != index){
+        link = &cache->entries[*link].next_in_bucket;
+    }
+    *link = cache->entries[index].next_in_bucket;
+}
+
+static u32
+plan_lookup(PlanCache* cache, String8 key, u64 hash){
+    u32 index = cache->buckets[hash & (PLAN_CACHE_BUCKET_COUNT - 1)];
+    while(index != PLAN_NONE){
+        PlanEntry* entry = cache->entries + index;
+        if(entry->hash == hash && str8(entry->key, entry->key_size) == key){
+            break;
+        }
+        index = entry->next_in_bucket;
+    }
+    return(index);
+}
+
+// NOTE: Gives back a statement with its lifted values bound and the program to run it. Cached plans are owned by
+// the cache and stay valid until the next plan_cache_prepare, uncacheable statements are prepared into tm.
+static PrepareResult
+plan_cache_prepare(PlanCache* cache, Table* table, String8 input, Statement** statement_out, Program** program_out){
+    PROFILE_BLOCK("plan");
+    u8 key_buffer[PLAN_KEY_MAX];
+    u32 key_size = 0;
+    PlanLiteral literals[STATEMENT_MAX_PARAMS];
+    u32 literal_count = 0;
+    if(!plan_normalize(input, key_buffer, &key_size, literals, &literal_count)){
+        Statement* statement = push_struct(tm, Statement);
+        PrepareResult result = prepare_statement(input, statement);
+        if(result == PrepareResult_success){
+            Program* program = push_struct(tm, Program);
+            compile_statement(statement, program);
+            *statement_out = statement;
+            *program_out = program;
+        }
+        return(result);
+    }
+
+    String8 key = str8(key_buffer, key_size);
+    u64 hash = str8_hash(key);
+    u32 index = plan_lookup(cache, key, hash);
+    bool stale = (index != PLAN_NONE && cache->entries[index].schema_version != table->schema_version);
+    if(index != PLAN_NONE && !stale){
+        cache->hits += 1;
+    }
+    else{
+        cache->misses += 1;
+        Statement prepared;
+        PrepareResult result = prepare_statement(key, &prepared);
+        if(result != PrepareResult_success){
+            return(result);
+        }
+
+        if(index == PLAN_NONE){
+            // NOTE: Take a fresh entry while there are some, then recycle the least recently used one.
+            if(cache->count < PLAN_CACHE_SIZE){
+                index = cache->count++;
+                plan_lru_push_front(cache, index);
+            }
+            else{
+                index = cache->lru_tail;
+                plan_bucket_unlink(cache, index);
+            }
+            PlanEntry* entry = cache->entries + index;
+            entry->hash = hash;
+            entry->key_size = key_size;
+            mem_copy(entry->key, key_buffer, key_size);
+            u32 bucket = hash & (PLAN_CACHE_BUCKET_COUNT - 1);
+            entry->next_in_bucket = cache->buckets[bucket];
+            cache->buckets[bucket] = index;
+        }
+
+        // NOTE: A stale entry keeps its key and slot, only the plan is rebuilt.
+        PlanEntry* entry = cache->entries + index;
+        entry->schema_version = table->schema_version;
+        entry->statement = prepared;
+        compile_statement(&entry->statement, &entry->program);
+    }
+    plan_lru_unlink(cache, index);
+    plan_lru_push_front(cache, index);
+
+    PlanEntry* entry = cache->entries + index;
+    Statement* statement = &entry->statement;
+    statement->bound = 0;
+    for(u32 i=0; i < literal_count; ++i){
+        if(literals[i].value.str == 0){
+            continue;
+        }
+        PrepareResult result = statement_bind_str8(statement, i, literals[i].value);
+        if(result != PrepareResult_success){
+            return(result);
+        }
+    }
+    *statement_out = statement;
+    *program_out = &entry->program;
+    return(PrepareResult_success);
+}
+
+static ExecuteResult
+execute_program(Table* table, Statement* statement, Program* program, ResultSink* sink){
+    if(!statement_is_bound(statement)){
+        return(ExecuteResult_unbound_parameter);
+    }
+    if(table->io_failed){
+        return(ExecuteResult_io_error);
+    }
+    return(vm_execute(table, program, sink));
 }
 
 static void
 str8_strip_newline(String8* str){
-    u8* ptr = str->str + str->size - 1;
-    *ptr = 0;
-    str->size -= 1;
+    // NOTE: Strips a trailing \n or \r\n, the last line of a file or a line at eof may not have one.
+    while(str->size > 0 && (str->str[str->size - 1] == '\n' || str->str[str->size - 1] == '\r')){
+        str->size -= 1;
+        str->str[str->size] = 0;
+    }
 }
 
-s32 main(s32 argc, char** argv){
-    //os_file_delete(dir, filename);
-    init_table(&table);
-    db_open(pm, &table);
+// NOTE: Non-interactive input (--script file, or stdin that isn't a terminal). The input is block read into one
+// buffer and handed out a line at a time as slices of that buffer, the tokenizer only reads them. Nothing is copied
+// per line, a partial line at the end of a block is moved to the front before the next read. A line that doesn't
+// fit in the buffer is reported and dropped up to its newline, reading continues with the line after it.
+global u64 const SCRIPT_BUFFER_SIZE = MB(1);
+
+typedef struct StatementReader{
+    OSFile file;
+    u8* buffer;
+    u64 start;
+    u64 end;
+    bool eof;
+    bool skipping;      // NOTE: inside a line that was too long, dropping input up to its newline
+    u64 skipped_lines;
+    u64 line_number;
+} StatementReader;
+
+static void
+statement_reader_init(Arena* arena, StatementReader* reader, OSFile file){
+    reader->file = file;
+    // NOTE: One spare byte so a last line without a newline can still be null terminated.
+    reader->buffer = push_array(arena, u8, SCRIPT_BUFFER_SIZE + 1);
+    reader->start = 0;
+    reader->end = 0;
+    reader->eof = false;
+    reader->skipping = false;
+    reader->skipped_lines = 0;
+    reader->line_number = 0;
+}
+
+static bool
+statement_reader_next(StatementReader* reader, String8* line){
+    for(;;){
+        u8* base = reader->buffer + reader->start;
+        u64 available = reader->end - reader->start;
+        u8* newline = (u8*)memchr(base, '\n', available);
+        if(reader->skipping){
+            if(newline){
+                reader->start += (u64)(newline + 1 - base);
+                reader->line_number += 1;
+                reader->skipping = false;
+                continue;
+            }
+            reader->start = reader->end;
+            base = reader->buffer + reader->start;
+            available = 0;
+        }
+        else if(newline){
+            *line = str8_range(base, newline + 1);
+            reader->start += line->size;
+            reader->line_number += 1;
+            str8_strip_newline(line);
+            return(true);
+        }
+        if(reader->eof){
+            if(available == 0){
+                return(false);
+            }
+            *line = str8(base, available);
+            line->str[line->size] = 0;
+            reader->start = reader->end;
+            reader->line_number += 1;
+            str8_strip_newline(line);
+            return(true);
+        }
+
+        // NOTE: No full line left, slide the partial one to the front and read more behind it.
+        if(reader->start == 0 && reader->end == SCRIPT_BUFFER_SIZE){
+            print("line %llu: longer than %llu bytes, skipping it.\n", (unsigned long long)(reader->line_number + 1), (unsigned long long)SCRIPT_BUFFER_SIZE);
+            reader->skipping = true;
+            reader->skipped_lines += 1;
+            continue;
+        }
+        memmove(reader->buffer, base, available);
+        reader->end = available;
+        reader->start = 0;
+        s64 count = os_file_read_next(reader->file, reader->buffer + reader->end, SCRIPT_BUFFER_SIZE - reader->end);
+        if(count <= 0){
+            reader->eof = true;
+        }
+        else{
+            reader->end += (u64)count;
+        }
+    }
+}
+
+static void
+write_prepare_error(Writer* w, PrepareResult result, String8 input){
+    switch(result){
+        case PrepareResult_success:{
+        } break;
+        case PrepareResult_syntax_error:{
+            writer_push_str8(w, str8_literal("Sysntax error. Could not parse statement.\n"));
+        } break;
+        case PrepareResult_negative_id:{
+            writer_push_str8(w, str8_literal("ID must be positive.\n"));
+        } break;
+        case PrepareResult_username_too_long:{
+            writer_push_str8(w, str8_literal("Username string is too long. Max: "));
+            writer_push_u64(w, USERNAME_SIZE);
+            writer_push_u8(w, '\n');
+        } break;
+        case PrepareResult_email_too_long:{
+            writer_push_str8(w, str8_literal("Email string is too long. Max: "));
+            writer_push_u64(w, EMAIL_SIZE);
+            writer_push_u8(w, '\n');
+        } break;
+        case PrepareResult_unrecognized_statement:{
+            writer_push_str8(w, str8_literal("Unrecognized keyword: '"));
+            writer_push_str8(w, input);
+            writer_push_str8(w, str8_literal("'\n"));
+        } break;
+    }
+}
+
+static void
+write_execute_error(Writer* w, ExecuteResult result){
+    switch(result){
+        case ExecuteResult_success:{
+        } break;
+        case ExecuteResult_duplicate_key:{
+            writer_push_str8(w, str8_literal("Error: Duplicate key.\n"));
+        } break;
+        case ExecuteResult_table_full:{
+            writer_push_str8(w, str8_literal("Error: Table full.\n"));
+        } break;
+        case ExecuteResult_unbound_parameter:{
+            writer_push_str8(w, str8_literal("Error: Statement has unbound parameters.\n"));
+        } break;
+        case ExecuteResult_io_error:{
+            writer_push_str8(w, str8_literal("Error: A page read or write failed, reopen the db.\n"));
+        } break;
+    }
+}
+
+///////////////////////////////
+// NOTE: Explain Analyze
+///////////////////////////////
+// NOTE: `explain analyze <statement>` runs the statement and reports on the run instead of its rows: the access
+// path and scan kernel scan_init() picks, pages visited per tree level, rows examined vs returned, the buffer
+// pool's hits and misses, and how long parsing, compiling, executing and formatting the output took. It goes
+// around the plan cache so parse and plan are measured on their own, and rows are formatted in the sink's
+// format and then dropped, so output costs what it would have. An insert really inserts.
+
+global char const* text_match_names[TextMatch_COUNT] = {"=", "like x%", "like %x", "like %x%"};
+
+static void
+explain_discard_flush(void* user, u8*, u64 size){
+    u64* bytes = (u64*)user;
+    *bytes += size;
+}
+
+static void
+explain_write_plan(Writer* w, Statement* statement){
+    if(statement->type == StatementType_insert){
+        writer_push_format(w, "plan            insert id %u\n", statement->row.id);
+        return;
+    }
+    Scan scan;
+    if(!scan_init(&scan, &statement->filter)){
+        writer_push_str8(w, str8_literal("plan            no scan, no id can satisfy the filter\n"));
+        return;
+    }
+    if(scan.id_min == 0){
+        writer_push_str8(w, str8_literal("plan            full scan from the first leaf"));
+    }
+    else{
+        writer_push_format(w, "plan            seek to id %u", scan.id_min);
+    }
+    if(scan.id_max != u32_max){
+        writer_push_format(w, ", stop after id %u", scan.id_max);
+    }
+
+    if(scan.kernel == scan_leaf<MatchAll>){
+        writer_push_str8(w, str8_literal(", every row in range"));
+    }
+    else if(scan.kernel == scan_leaf<MatchFilter>){
+        writer_push_str8(w, str8_literal(", generic filter per row"));
+    }
+    for(u32 column=0; column < 2; ++column){
+        for(u32 match=0; match < TextMatch_COUNT; ++match){
+            if(scan.kernel == text_scan_kernels[column][match]){
+                writer_push_format(w, ", %s %s kernel", column ? "email" : "username", text_match_names[match]);
+            }
+        }
+    }
+    if(statement->limit != u32_max){
+        writer_push_format(w, ", limit %u", statement->limit);
+    }
+    writer_push_u8(w, '\n');
+}
+
+static bool
+explain_analyze(ResultSink* sink, String8 input){
+    Writer* w = &sink->writer;
+    f64 us_per_tick = 1000000.0 / (f64)cpu_timer_frequency();
+
+    u64 parse_begin = read_cpu_timer();
+    Statement* statement = push_struct(tm, Statement);
+    PrepareResult prepare_result = prepare_statement(input, statement);
+    u64 parse_ticks = read_cpu_timer() - parse_begin;
+    if(prepare_result != PrepareResult_success){
+        write_prepare_error(w, prepare_result, input);
+        writer_flush(w);
+        return(false);
+    }
+    if(!statement_is_bound(statement)){
+        write_execute_error(w, ExecuteResult_unbound_parameter);
+        writer_flush(w);
+        return(false);
+    }
 
+    u64 plan_begin = read_cpu_timer();
+    Program* program = push_struct(tm, Program);
+    compile_statement(statement, program);
+    u64 plan_ticks = read_cpu_timer() - plan_begin;
+
+    u64 output_bytes = 0;
+    ResultSink discard;
+    result_sink_init(tm, &discard, KB(64), explain_discard_flush, &output_bytes);
+    discard.format = sink->format;
+
+    TableCounters before = table.counters;
+    VMStats stats = ZERO_INIT;
+    VM vm;
+    u64 execute_begin = read_cpu_timer();
+    vm_init(&vm, &table, program, &discard);
+    vm.stats = &stats;
+    vm_run(&vm);
+    u64 execute_ticks = read_cpu_timer() - execute_begin - stats.output_ticks;
+    TableCounters* after = &table.counters;
+
+    explain_write_plan(w, statement);
+    if(statement->type == StatementType_select){
+        writer_push_format(w, "rows            examined %llu, returned %llu, %llu output bytes\n",
+                            (unsigned long long)stats.rows_examined, (unsigned long long)stats.rows_returned,
+                            (unsigned long long)output_bytes);
+        writer_push_format(w, "leaves scanned  %llu\n", (unsigned long long)stats.leaves);
+    }
+    writer_push_str8(w, str8_literal("pages visited  "));
+    char const* separator = " ";
+    for(u32 level=0; level < TREE_MAX_LEVELS; ++level){
+        u64 pages = after->level_pages[level] - before.level_pages[level];
+        if(pages){
+            writer_push_format(w, "%slevel %u: %llu", separator, level, (unsigned long long)pages);
+            separator = ", ";
+        }
+    }
+    writer_push_str8(w, (separator[0] == ' ') ? str8_literal(" none\n") : str8_literal("\n"));
+    writer_push_format(w, "buffer pool     hits %llu, misses %llu, prefetches %llu, pages read %llu, pages written %llu\n",
+                        (unsigned long long)(after->cache_hits - before.cache_hits),
+                        (unsigned long long)(after->cache_misses - before.cache_misses),
+                        (unsigned long long)(after->prefetches - before.prefetches),
+                        (unsigned long long)(after->pages_read - before.pages_read),
+                        (unsigned long long)(after->pages_written - before.pages_written));
+    if(after->leaf_splits != before.leaf_splits){
+        writer_push_format(w, "splits          leaf %llu, root %llu\n",
+                            (unsigned long long)(after->leaf_splits - before.leaf_splits),
+                            (unsigned long long)(after->root_splits - before.root_splits));
+    }
+    writer_push_format(w, "time (us)       parse %.2f, plan %.2f, execute %.2f, output %.2f\n",
+                        (f64)parse_ticks * us_per_tick, (f64)plan_ticks * us_per_tick,
+                        (f64)execute_ticks * us_per_tick, (f64)stats.output_ticks * us_per_tick);
+    write_execute_error(w, vm.result);
+    writer_flush(w);
+    return(vm.result == ExecuteResult_success);
+}
+
+// NOTE: Runs one statement, its rows and any error go to sink. `verbose` adds the "Executed." confirmation the
+// repl and server clients get. Returns false on any error.
+static bool
+run_sql(ResultSink* sink, String8 input, bool verbose){
+    PROFILE_BLOCK("statement");
+    String8 explain = str8_literal("explain analyze ");
+    if(str8_starts_with(input, explain)){
+        return(explain_analyze(sink, str8_substr_left(input, explain.size, input.size)));
+    }
+
+    Writer* w = &sink->writer;
+    Statement* statement = 0;
+    Program* program = 0;
+    PrepareResult prepare_result = plan_cache_prepare(&plan_cache, &table, input, &statement, &program);
+    write_prepare_error(w, prepare_result, input);
+    bool ok = (prepare_result == PrepareResult_success);
+    if(ok){
+        ExecuteResult execute_result = execute_program(&table, statement, program, sink);
+        ok = (execute_result == ExecuteResult_success);
+        write_execute_error(w, execute_result);
+        if(ok && verbose){
+            writer_push_str8(w, str8_literal("Executed.\n"));
+        }
+    }
+    writer_flush(w);
+    return(ok);
+}
+
+// NOTE: Runs one line of input, either a meta command or a statement. Errors are always printed, `verbose` adds
+// the "Executed." confirmation the repl shows. Returns false on any error.
+static bool
+run_statement(String8 input, bool verbose){
+    if(input.size > 0 && input.str[0] == '.'){
+        MetaCommand command = do_meta_command(input);
+        switch(command){
+            case MetaCommand_success:{
+            } return(true);
+            case MetaCommand_unrecognized:{
+                print("Unrecognized command: '%.*s'\n", (s32)input.size, input.str);
+            } return(false);
+        }
+    }
+    return(run_sql(&result_sink, input, verbose));
+}
+
+static s32
+run_script(OSFile file){
+    // NOTE: No prompts and no "Executed.", only select output and errors, each error tagged with its line.
+    StatementReader reader;
+    statement_reader_init(pm, &reader, file);
+    u64 error_count = 0;
+    String8 line;
+    while(running && statement_reader_next(&reader, &line)){
+        // NOTE: Blank lines, including ones that are only spaces and tabs, are skipped.
+        String8 rest = line;
+        if(str8_next_token(&rest, TOKEN_DELIMITERS).size == 0){
+            continue;
+        }
+        if(!run_statement(line, false)){
+            print("  at line %llu\n", (unsigned long long)reader.line_number);
+            error_count += 1;
+        }
+        arena_free(tm);
+    }
+    error_count += reader.skipped_lines;
+    db_close(&table);
+    return(error_count ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static s32
+run_repl(void){
     while(running){
         print("db > ");
         String8 input = read_stdin(tm);
+        if(input.size == 0 && feof(stdin)){
+            // NOTE: ctrl-d / end of input, same as .exit
+            break;
+        }
         str8_strip_newline(&input);
+        run_statement(input, true);
+        arena_free(tm);
+    }
+    db_close(&table);
+    return(EXIT_SUCCESS);
+}
 
-        if(input.str[0] == '.'){
-            MetaCommand command = do_meta_command(input);
-            switch(command){
-                case MetaCommand_success:{
-                } continue;
-                case MetaCommand_unrecognized:{
-                    print("Unrecognized command: '%.*s'\n", (s32)input.size, input.str);
-                } continue;
-            }
+///////////////////////////////
+// NOTE: Server
+///////////////////////////////
+// NOTE: --server <path> serves statements over a Unix domain socket. Clients send statements a line at a time and
+// get back what the repl would print for them, each statement's output ends with "Executed." or an error line.
+// `.exit` closes the connection, `.stats` and `.latency` report on the shared table, other meta commands act on the whole
+// process and aren't available.
+//
+// One thread runs the epoll loop: it accepts connections and hands any connection with input to the worker pool.
+// Connections are registered oneshot, a connection is owned by the worker that picked it up until it's rearmed,
+// so its statements run one at a time and in order. The engine (table, buffer pool, plan cache, tm) is single
+// threaded, statements run under engine_mutex. Results are only copied out under the lock, the sends happen
+// after it's dropped, so a slow reader doesn't hold up other connections. Everything a read brought in is run
+// before the answers go out in one send, a client can pipeline as many requests as it likes.
+//
+// A client that opens with the 4 byte WIRE_MAGIC (text never starts with a 0 byte) switches its connection to the
+// binary protocol, the server answers with the same magic. Every frame after that is
+//     u32 size | u8 WireMessage | payload, size - 1 bytes
+// little endian, size counts the message byte and the payload.
+//     prepare  text                          -> prepared  u32 statement, u32 param_count, u32 columns
+//     execute  u32 statement, u32 count,     -> rows*, done  u32 ExecuteResult, u64 rows
+//              count x (u8 WireParam_u32, u32 | u8 WireParam_text, u32 size, bytes)
+//     close    u32 statement                 -> done
+//     query    text                          -> rows*, done   (one off through the plan cache, no parameters)
+// rows frames carry result rows in the ResultFormat_binary encoding of the statement's columns, a row can be split
+// across frames. A request that fails is answered with error  u32 WireError, u32 detail, message text; detail is the
+// PrepareResult for prepare and bind errors. A malformed frame gets an error and the connection is closed.
+#if OS_LINUX
+#define SERVER_MAX_WORKERS 64
+#define SERVER_TAG_LISTENER 0
+#define CONNECTION_MAX_STATEMENTS 64
+#define WIRE_MAGIC "\0DBB"
+#define WIRE_FRAME_HEADER_SIZE 5
+
+typedef enum WireMessage{
+    WireMessage_prepare  = 0x01,
+    WireMessage_execute  = 0x02,
+    WireMessage_close    = 0x03,
+    WireMessage_query    = 0x04,
+    WireMessage_prepared = 0x81,
+    WireMessage_rows     = 0x82,
+    WireMessage_done     = 0x83,
+    WireMessage_error    = 0x84,
+} WireMessage;
+
+typedef enum WireParam{
+    WireParam_u32,
+    WireParam_text,
+} WireParam;
+
+typedef enum WireError{
+    WireError_malformed = 1,     // NOTE: frame doesn't parse, the connection is closed after this
+    WireError_prepare,
+    WireError_bind,
+    WireError_no_statement,      // NOTE: unknown or closed statement id
+    WireError_too_many_statements,
+} WireError;
+
+typedef enum ConnectionProtocol{
+    ConnectionProtocol_unknown, // NOTE: nothing read yet
+    ConnectionProtocol_text,
+    ConnectionProtocol_binary,
+} ConnectionProtocol;
+
+typedef struct PreparedSlot{
+    bool used;
+    Statement statement;
+    Program program;
+} PreparedSlot;
+
+global u32 const SERVER_DEFAULT_WORKERS = 4;
+global s32 const SERVER_POLL_TIMEOUT_MS = 250; // NOTE: how often the event loop looks at `running`
+global u64 const CONNECTION_INPUT_SIZE = KB(64); // NOTE: longest statement line a client can send
+global u64 const CONNECTION_RESULT_BUFFER_SIZE = KB(64);
+
+typedef struct OutputChunk{
+    u8* data;
+    u64 size;
+    struct OutputChunk* next;
+} OutputChunk;
+
+typedef struct Connection{
+    Arena* arena;
+    OSSocket socket;
+    u8* input;
+    u64 input_used;
+    ConnectionProtocol protocol;
+    ResultSink sink;
+    PreparedSlot* statements; // NOTE: binary protocol only, CONNECTION_MAX_STATEMENTS of them
+    u64 output_pos; // NOTE: arena position the pending output starts at
+    OutputChunk* output_first;
+    OutputChunk* output_last;
+    struct Connection* next_ready;
+} Connection;
+
+typedef struct Server{
+    OSSocket listener;
+    OSPoller poller;
+    OSMutex engine_mutex;
+    OSMutex queue_mutex;
+    OSCondition queue_ready;
+    Connection* ready_first;
+    Connection* ready_last;
+    bool stopping;
+    u32 worker_count;
+    OSThread workers[SERVER_MAX_WORKERS];
+} Server;
+global Server server;
+
+// NOTE: Queues an output chunk of size bytes and hands it back for the caller to fill.
+static u8*
+connection_push_chunk(Connection* connection, u64 size){
+    OutputChunk* chunk = push_struct(connection->arena, OutputChunk);
+    chunk->data = push_array(connection->arena, u8, size);
+    chunk->size = size;
+    chunk->next = 0;
+    if(connection->output_last){
+        connection->output_last->next = chunk;
+    }
+    else{
+        connection->output_first = chunk;
+    }
+    connection->output_last = chunk;
+    return(chunk->data);
+}
+
+static void
+connection_push_output(void* user, u8* data, u64 size){
+    // NOTE: Result sink flush, runs under engine_mutex. Only copies, connection_send_output() does the sending.
+    Connection* connection = (Connection*)user;
+    mem_copy(connection_push_chunk(connection, size), data, size);
+}
+
+static void
+wire_put_u32(u8* dest, u32 value){
+    dest[0] = (u8)(value);
+    dest[1] = (u8)(value >> 8);
+    dest[2] = (u8)(value >> 16);
+    dest[3] = (u8)(value >> 24);
+}
+
+static void
+wire_put_u64(u8* dest, u64 value){
+    wire_put_u32(dest, (u32)value);
+    wire_put_u32(dest + 4, (u32)(value >> 32));
+}
+
+static u32
+wire_get_u32(u8* src){
+    return((u32)src[0] | ((u32)src[1] << 8) | ((u32)src[2] << 16) | ((u32)src[3] << 24));
+}
+
+static void
+connection_push_frame(Connection* connection, WireMessage message, void const* payload, u64 size){
+    u8* frame = connection_push_chunk(connection, WIRE_FRAME_HEADER_SIZE + size);
+    wire_put_u32(frame, (u32)size + 1);
+    frame[4] = (u8)message;
+    mem_copy(frame + WIRE_FRAME_HEADER_SIZE, payload, size);
+}
+
+static void
+connection_push_rows(void* user, u8* data, u64 size){
+    // NOTE: Result sink flush for binary connections, every flush becomes one rows frame.
+    connection_push_frame((Connection*)user, WireMessage_rows, data, size);
+}
+
+static void
+connection_push_error(Connection* connection, WireError error, u32 detail, String8 message){
+    u8* frame = connection_push_chunk(connection, WIRE_FRAME_HEADER_SIZE + 8 + message.size);
+    wire_put_u32(frame, (u32)(1 + 8 + message.size));
+    frame[4] = WireMessage_error;
+    wire_put_u32(frame + 5, (u32)error);
+    wire_put_u32(frame + 9, detail);
+    mem_copy(frame + 13, message.str, message.size);
+}
+
+static void
+connection_push_done(Connection* connection, ExecuteResult result, u64 rows){
+    u8 payload[12];
+    wire_put_u32(payload, (u32)result);
+    wire_put_u64(payload + 4, rows);
+    connection_push_frame(connection, WireMessage_done, payload, sizeof(payload));
+}
+
+static bool
+connection_send_output(Connection* connection){
+    bool result = true;
+    for(OutputChunk* chunk = connection->output_first; chunk && result; chunk = chunk->next){
+        result = os_socket_write(connection->socket, chunk->data, chunk->size);
+    }
+    connection->output_first = 0;
+    connection->output_last = 0;
+    arena_pop_to(connection->arena, connection->output_pos);
+    return(result);
+}
+
+static Connection*
+connection_open(OSSocket socket){
+    Arena* arena = arena_reserve(MB(64), ArenaFlag_decommit_on_reset);
+    Connection* connection = push_struct(arena, Connection);
+    connection->arena = arena;
+    connection->socket = socket;
+    connection->input = push_array(arena, u8, CONNECTION_INPUT_SIZE + 1);
+    connection->input_used = 0;
+    connection->protocol = ConnectionProtocol_unknown;
+    connection->statements = 0;
+    result_sink_init(arena, &connection->sink, CONNECTION_RESULT_BUFFER_SIZE, connection_push_output, connection);
+    connection->output_pos = arena_pos(arena);
+    connection->output_first = 0;
+    connection->output_last = 0;
+    connection->next_ready = 0;
+    return(connection);
+}
+
+static void
+connection_close(Connection* connection){
+    // NOTE: Closing the socket also takes it out of the poller.
+    os_socket_close(connection->socket);
+    arena_release(connection->arena);
+}
+
+// NOTE: Runs every complete line in the input buffer and keeps the partial one. Returns false once the connection
+// should close.
+static bool
+connection_run_lines(Connection* connection){
+    bool result = true;
+    u8* base = connection->input;
+    u64 start = 0;
+    while(result){
+        u8* newline = (u8*)memchr(base + start, '\n', connection->input_used - start);
+        if(!newline){
+            break;
+        }
+        String8 line = str8_range(base + start, newline + 1);
+        start += line.size;
+        str8_strip_newline(&line);
+        if(line.size == 0){
+            continue;
+        }
+        if(line == str8_literal(".exit")){
+            result = false;
+            break;
         }
 
-        Statement statement;
-        PrepareResult prepare_result = prepare_statement(input, &statement);
-        switch(prepare_result){
-            case PrepareResult_success:{
-            } break;
-            case PrepareResult_syntax_error:{
-                print("Sysntax error. Could not parse statement.\n");
-            } continue;
-            case PrepareResult_negative_id:{
-                print("ID must be positive.\n");
-            } continue;
-            case PrepareResult_username_too_long:{
-                print("Username string is too long. Max: %d\n", USERNAME_SIZE);
-            } continue;
-            case PrepareResult_email_too_long:{
-                print("Email string is too long. Max: %d\n", EMAIL_SIZE);
-            } continue;
-            case PrepareResult_unrecognized_statement:{
-                print("Unrecognized keyword: '%.*s'\n", (s32)input.size, input.str);
-            } continue;
-        }
-
-        ExecuteResult execute_result = execute_statement(&table, &statement);
-        switch(execute_result){
-            case ExecuteResult_success:{
-                print("Executed.\n");
-            } break;
-            case ExecuteResult_duplicate_key:{
-                print("Error: Duplicate key.\n");
-            } break;
-            case ExecuteResult_table_full:{
-                print("Error: Table full.\n");
-            } break;
+        if(line == str8_literal(".stats")){
+            TableStats stats;
+            os_mutex_lock(&server.engine_mutex);
+            table_collect_stats(&table, pm, &stats);
+            os_mutex_unlock(&server.engine_mutex);
+            table_write_stats(&connection->sink.writer, &stats);
+            writer_flush(&connection->sink.writer);
         }
-        arena_free(tm);
+        else if(line == str8_literal(".latency")){
+            // NOTE: A copy, so the report is formatted without holding up the engine.
+            Histogram histograms[StatementKind_COUNT];
+            os_mutex_lock(&server.engine_mutex);
+            mem_copy(histograms, statement_latency, sizeof(statement_latency));
+            os_mutex_unlock(&server.engine_mutex);
+            latency_write_report(&connection->sink.writer, histograms);
+            writer_flush(&connection->sink.writer);
+        }
+        else if(line.str[0] == '.'){
+            Writer* w = &connection->sink.writer;
+            writer_push_str8(w, str8_literal("Unrecognized command: '"));
+            writer_push_str8(w, line);
+            writer_push_str8(w, str8_literal("'\n"));
+            writer_flush(w);
+        }
+        else{
+            os_mutex_lock(&server.engine_mutex);
+            run_sql(&connection->sink, line, true);
+            arena_free(tm);
+            os_mutex_unlock(&server.engine_mutex);
+        }
+    }
+    memmove(base, base + start, connection->input_used - start);
+    connection->input_used -= start;
+    return(result);
+}
+
+// NOTE: Bounds checked reads from a frame's payload. ok sticks at false after the first read past the end.
+typedef struct WireReader{
+    u8* at;
+    u8* end;
+    bool ok;
+} WireReader;
+
+static u8
+wire_read_u8(WireReader* reader){
+    if(reader->end - reader->at < 1){
+        reader->ok = false;
+        return(0);
+    }
+    return(*reader->at++);
+}
+
+static u32
+wire_read_u32(WireReader* reader){
+    if(reader->end - reader->at < 4){
+        reader->ok = false;
+        return(0);
+    }
+    u32 result = wire_get_u32(reader->at);
+    reader->at += 4;
+    return(result);
+}
+
+static String8
+wire_read_str8(WireReader* reader, u64 size){
+    if((u64)(reader->end - reader->at) < size){
+        reader->ok = false;
+        return(str8(0, 0));
+    }
+    String8 result = str8(reader->at, size);
+    reader->at += size;
+    return(result);
+}
+
+static String8
+wire_read_rest(WireReader* reader){
+    return(wire_read_str8(reader, (u64)(reader->end - reader->at)));
+}
+
+static PreparedSlot*
+connection_statement(Connection* connection, u32 id){
+    if(id < CONNECTION_MAX_STATEMENTS && connection->statements[id].used){
+        return(connection->statements + id);
     }
+    connection_push_error(connection, WireError_no_statement, id, str8_literal("No such statement."));
     return(0);
 }
+
+static void
+connection_execute(Connection* connection, Statement* statement, Program* program){
+    os_mutex_lock(&server.engine_mutex);
+    connection->sink.rows = 0;
+    ExecuteResult result = execute_program(&table, statement, program, &connection->sink);
+    os_mutex_unlock(&server.engine_mutex);
+    u64 rows = connection->sink.rows;
+    if(statement->type == StatementType_insert){
+        rows = (result == ExecuteResult_success);
+    }
+    connection_push_done(connection, result, rows);
+}
+
+// NOTE: Runs one binary request. Returns false when the frame is malformed, the connection is closed then.
+static bool
+connection_run_frame(Connection* connection, u8 message, WireReader* reader){
+    switch(message){
+        case WireMessage_prepare:{
+            // NOTE: Parsing and compiling don't touch the table, but their profile blocks write the profiler's
+            // globals, so they take engine_mutex like everything else that does.
+            String8 text = wire_read_rest(reader);
+            u32 id = 0;
+            while(id < CONNECTION_MAX_STATEMENTS && connection->statements[id].used){
+                id += 1;
+            }
+            if(id == CONNECTION_MAX_STATEMENTS){
+                connection_push_error(connection, WireError_too_many_statements, 0, str8_literal("Too many prepared statements."));
+                break;
+            }
+            PreparedSlot* slot = connection->statements + id;
+            os_mutex_lock(&server.engine_mutex);
+            PrepareResult result = prepare_statement(text, &slot->statement);
+            if(result == PrepareResult_success){
+                compile_statement(&slot->statement, &slot->program);
+            }
+            os_mutex_unlock(&server.engine_mutex);
+            if(result != PrepareResult_success){
+                connection_push_error(connection, WireError_prepare, result, str8_literal("Could not prepare statement."));
+                break;
+            }
+            slot->used = true;
+
+            u8 payload[12];
+            wire_put_u32(payload, id);
+            wire_put_u32(payload + 4, slot->statement.param_count);
+            wire_put_u32(payload + 8, (slot->statement.type == StatementType_select) ? slot->statement.columns : 0);
+            connection_push_frame(connection, WireMessage_prepared, payload, sizeof(payload));
+        } break;
+        case WireMessage_execute:{
+            PreparedSlot* slot = connection_statement(connection, wire_read_u32(reader));
+            u32 count = wire_read_u32(reader);
+            if(!slot){
+                break;
+            }
+            Statement* statement = &slot->statement;
+            if(count != statement->param_count){
+                connection_push_error(connection, WireError_bind, PrepareResult_syntax_error, str8_literal("Wrong number of parameters."));
+                break;
+            }
+            statement->bound = 0;
+            PrepareResult result = PrepareResult_success;
+            for(u32 i=0; i < count && result == PrepareResult_success; ++i){
+                u8 type = wire_read_u8(reader);
+                if(type == WireParam_u32){
+                    result = statement_bind_u32(statement, i, wire_read_u32(reader));
+                }
+                else{
+                    u32 size = wire_read_u32(reader);
+                    result = statement_bind_str8(statement, i, wire_read_str8(reader, size));
+                }
+                if(!reader->ok){
+                    return(false);
+                }
+            }
+            if(result != PrepareResult_success){
+                connection_push_error(connection, WireError_bind, result, str8_literal("Could not bind parameter."));
+                break;
+            }
+            connection_execute(connection, statement, &slot->program);
+        } break;
+        case WireMessage_close:{
+            PreparedSlot* slot = connection_statement(connection, wire_read_u32(reader));
+            if(slot){
+                slot->used = false;
+                connection_push_done(connection, ExecuteResult_success, 0);
+            }
+        } break;
+        case WireMessage_query:{
+            String8 text = wire_read_rest(reader);
+            Statement* statement = 0;
+            Program* program = 0;
+            os_mutex_lock(&server.engine_mutex);
+            PrepareResult result = plan_cache_prepare(&plan_cache, &table, text, &statement, &program);
+            ExecuteResult execute_result = ExecuteResult_success;
+            u64 rows = 0;
+            if(result == PrepareResult_success){
+                connection->sink.rows = 0;
+                execute_result = execute_program(&table, statement, program, &connection->sink);
+                rows = (statement->type == StatementType_insert) ? (execute_result == ExecuteResult_success) : connection->sink.rows;
+            }
+            arena_free(tm);
+            os_mutex_unlock(&server.engine_mutex);
+            if(result != PrepareResult_success){
+                connection_push_error(connection, WireError_prepare, result, str8_literal("Could not prepare statement."));
+                break;
+            }
+            connection_push_done(connection, execute_result, rows);
+        } break;
+        default:{
+            reader->ok = false;
+        } break;
+    }
+    return(reader->ok);
+}
+
+// NOTE: Runs every complete frame in the input buffer and keeps the partial one. Returns false once the connection
+// should close.
+static bool
+connection_run_frames(Connection* connection){
+    bool result = true;
+    u8* base = connection->input;
+    u64 start = 0;
+    while(connection->input_used - start >= 4){
+        u32 size = wire_get_u32(base + start);
+        if(size == 0 || size > CONNECTION_INPUT_SIZE - 4){
+            result = false;
+            break;
+        }
+        if(connection->input_used - start - 4 < size){
+            break;
+        }
+        u8* frame = base + start + 4;
+        WireReader reader = {frame + 1, frame + size, true};
+        start += 4 + size;
+        if(!connection_run_frame(connection, frame[0], &reader)){
+            result = false;
+            break;
+        }
+    }
+    if(!result){
+        connection_push_error(connection, WireError_malformed, 0, str8_literal("Malformed frame."));
+    }
+    memmove(base, base + start, connection->input_used - start);
+    connection->input_used -= start;
+    return(result);
+}
+
+// NOTE: Picks the protocol from the first bytes a connection sends. Returns false when the connection should close.
+static bool
+connection_pick_protocol(Connection* connection){
+    if(connection->input[0] != 0){
+        connection->protocol = ConnectionProtocol_text;
+        return(true);
+    }
+    u32 magic_size = sizeof(WIRE_MAGIC) - 1;
+    if(connection->input_used < magic_size){
+        return(true);
+    }
+    if(!mem_match(connection->input, WIRE_MAGIC, magic_size)){
+        return(false);
+    }
+    connection->input_used -= magic_size;
+    memmove(connection->input, connection->input + magic_size, connection->input_used);
+
+    connection->protocol = ConnectionProtocol_binary;
+    connection->statements = push_array(connection->arena, PreparedSlot, CONNECTION_MAX_STATEMENTS);
+    for(u32 i=0; i < CONNECTION_MAX_STATEMENTS; ++i){
+        connection->statements[i].used = false;
+    }
+    connection->sink.format = ResultFormat_binary;
+    connection->sink.writer.flush = connection_push_rows;
+    connection->output_pos = arena_pos(connection->arena);
+    mem_copy(connection_push_chunk(connection, magic_size), WIRE_MAGIC, magic_size);
+    return(true);
+}
+
+static bool
+connection_run_input(Connection* connection){
+    bool result = true;
+    if(connection->protocol == ConnectionProtocol_unknown){
+        result = connection_pick_protocol(connection);
+    }
+    if(result && connection->protocol == ConnectionProtocol_text){
+        result = connection_run_lines(connection);
+    }
+    else if(result && connection->protocol == ConnectionProtocol_binary){
+        result = connection_run_frames(connection);
+    }
+    // NOTE: Whatever was answered goes out even when the connection is about to close.
+    if(!connection_send_output(connection)){
+        result = false;
+    }
+    return(result);
+}
+
+// NOTE: Reads until the socket has nothing more buffered, running requests as they complete. Returns false once the
+// connection should close.
+static bool
+connection_service(Connection* connection){
+    for(;;){
+        if(connection->input_used == CONNECTION_INPUT_SIZE){
+            // NOTE: Only a text line can fill the buffer, connection_run_frames() rejects frames that wouldn't fit.
+            Writer* w = &connection->sink.writer;
+            writer_push_str8(w, str8_literal("Error: Statement is longer than "));
+            writer_push_u64(w, CONNECTION_INPUT_SIZE);
+            writer_push_str8(w, str8_literal(" bytes.\n"));
+            writer_flush(w);
+            connection_send_output(connection);
+            return(false);
+        }
+        s64 count = os_socket_read(connection->socket, connection->input + connection->input_used, CONNECTION_INPUT_SIZE - connection->input_used);
+        if(count == OS_SOCKET_WOULD_BLOCK){
+            return(true);
+        }
+        if(count == 0){
+            return(false);
+        }
+        connection->input_used += (u64)count;
+        if(!connection_run_input(connection)){
+            return(false);
+        }
+    }
+}
+
+static void
+server_worker(void*){
+    for(;;){
+        os_mutex_lock(&server.queue_mutex);
+        while(!server.ready_first && !server.stopping){
+            os_condition_wait(&server.queue_ready, &server.queue_mutex);
+        }
+        Connection* connection = server.ready_first;
+        if(connection){
+            server.ready_first = connection->next_ready;
+            if(!server.ready_first){
+                server.ready_last = 0;
+            }
+        }
+        os_mutex_unlock(&server.queue_mutex);
+        if(!connection){
+            // NOTE: Stopping and the queue is drained.
+            return;
+        }
+
+        if(connection_service(connection) && os_poller_rearm(server.poller, connection->socket, (u64)connection)){
+            continue;
+        }
+        connection_close(connection);
+    }
+}
+
+static void
+server_push_ready(Connection* connection){
+    os_mutex_lock(&server.queue_mutex);
+    connection->next_ready = 0;
+    if(server.ready_last){
+        server.ready_last->next_ready = connection;
+    }
+    else{
+        server.ready_first = connection;
+    }
+    server.ready_last = connection;
+    os_condition_signal(&server.queue_ready);
+    os_mutex_unlock(&server.queue_mutex);
+}
+
+static void
+server_interrupt(void){
+    running = false;
+}
+
+static s32
+run_server(String8 path, u32 worker_count){
+    server.listener = os_socket_listen_local(path);
+    if(!os_socket_is_valid(server.listener)){
+        db_close(&table);
+        return(EXIT_FAILURE);
+    }
+    server.poller = os_poller_create();
+    os_poller_add(server.poller, server.listener, SERVER_TAG_LISTENER, false);
+    os_mutex_init(&server.engine_mutex);
+    os_mutex_init(&server.queue_mutex);
+    os_condition_init(&server.queue_ready);
+    server.ready_first = 0;
+    server.ready_last = 0;
+    server.stopping = false;
+    server.worker_count = CLAMP(1, worker_count, SERVER_MAX_WORKERS);
+    for(u32 i=0; i < server.worker_count; ++i){
+        os_thread_start(server.workers + i, server_worker, 0);
+    }
+    os_set_interrupt_handler(server_interrupt);
+    print("Listening on '%.*s' with %d workers.\n", (s32)path.size, path.str, server.worker_count);
+    fflush(stdout);
+
+    OSPollEvent events[64];
+    while(running){
+        u32 count = os_poller_wait(server.poller, events, array_count(events), SERVER_POLL_TIMEOUT_MS);
+        for(u32 i=0; i < count; ++i){
+            if(events[i].tag != SERVER_TAG_LISTENER){
+                server_push_ready((Connection*)events[i].tag);
+                continue;
+            }
+            for(OSSocket socket = os_socket_accept(server.listener); os_socket_is_valid(socket); socket = os_socket_accept(server.listener)){
+                Connection* connection = connection_open(socket);
+                if(!os_poller_add(server.poller, socket, (u64)connection, true)){
+                    connection_close(connection);
+                }
+            }
+        }
+    }
+
+    // NOTE: Workers finish what's queued, then exit. Idle connections are dropped with the process.
+    os_mutex_lock(&server.queue_mutex);
+    server.stopping = true;
+    os_condition_broadcast(&server.queue_ready);
+    os_mutex_unlock(&server.queue_mutex);
+    for(u32 i=0; i < server.worker_count; ++i){
+        os_thread_join(server.workers + i);
+    }
+    os_socket_close(server.listener);
+    os_poller_destroy(server.poller);
+    db_close(&table);
+    print("Server stopped.\n");
+    return(EXIT_SUCCESS);
+}
+#endif
+
+// NOTE: Other translation units (db_microbench.cpp) include this file for the engine and provide their own main.
+#if !defined(DB_NO_MAIN)
+#if PROFILER
+static void
+write_trace_file(void){
+    // NOTE: atexit handler, so every way out of the process (.exit, end of input, server shutdown) writes it.
+    FileOutput output = {trace_path, 0};
+    os_file_delete(str8_literal(""), trace_path);
+    Writer w = writer_make(pm, MB(1), file_output_flush, &output);
+    profile_write_trace(&w);
+    writer_flush(&w);
+    print("Wrote %llu trace events to '%.*s'\n", (unsigned long long)profiler.event_count, (s32)trace_path.size, trace_path.str);
+}
+#endif
+
+s32 main(s32 argc, char** argv){
+    String8 script_path = ZERO_INIT;
+    String8 server_path = ZERO_INIT;
+    u32 worker_count = 0;
+    for(s32 i=1; i < argc; ++i){
+        String8 arg = str8_cstring((u8*)argv[i]);
+        if(arg == str8_literal("--direct")){
+            direct_io = true;
+        }
+        else if(arg == str8_literal("--huge-pages")){
+            huge_pages = true;
+        }
+        else if(arg == str8_literal("--script") && i + 1 < argc){
+            script_path = str8_cstring((u8*)argv[++i]);
+        }
+        else if(arg == str8_literal("--server") && i + 1 < argc){
+            server_path = str8_cstring((u8*)argv[++i]);
+        }
+        else if(arg == str8_literal("--workers") && i + 1 < argc){
+            u64 count = 0;
+            str8_to_u64(str8_cstring((u8*)argv[++i]), &count);
+            worker_count = (u32)MIN(count, (u64)u32_max);
+        }
+        else if(arg == str8_literal("--trace") && i + 1 < argc){
+#if PROFILER
+            trace_path = str8_cstring((u8*)argv[++i]);
+#else
+            i += 1;
+            print("--trace needs a build with PROFILER=1, ignoring it.\n");
+#endif
+        }
+    }
+
+    profile_reset();
+    latency_reset(statement_latency);
+#if PROFILER
+    if(trace_path.size){
+        profile_trace_begin(pm, TRACE_MAX_EVENTS);
+        atexit(write_trace_file);
+    }
+#endif
+
+    //os_file_delete(dir, filename);
+    result_sink_init(pm, &result_sink, RESULT_BUFFER_SIZE, result_sink_flush_stdout, 0);
+    plan_cache_init(&plan_cache);
+    if(!init_table(&table) || !db_open(pm, &table, dir, filename)){
+        return(EXIT_FAILURE);
+    }
+
+    if(server_path.size){
+#if OS_LINUX
+        return(run_server(server_path, worker_count ? worker_count : SERVER_DEFAULT_WORKERS));
+#else
+        print("Server mode is only available on Linux.\n");
+        db_close(&table);
+        return(EXIT_FAILURE);
+#endif
+    }
+
+    if(script_path.size){
+        OSFile script = os_file_open(str8_literal(""), script_path, OSFileFlag_sequential);
+        if(!os_file_is_valid(script)){
+            print("Could not open script '%.*s'\n", (s32)script_path.size, script_path.str);
+            db_close(&table);
+            return(EXIT_FAILURE);
+        }
+        s32 result = run_script(script);
+        os_file_close(script);
+        return(result);
+    }
+
+    OSFile input = os_file_stdin();
+    if(!os_file_is_interactive(input)){
+        return(run_script(input));
+    }
+    return(run_repl());
+}
+#endif
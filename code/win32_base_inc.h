@@ -3,6 +3,9 @@
 
 #include "win32_memory.h"
 #include "win32_file.h"
+#include "win32_io.h"
+#include "win32_thread.h"
+#include "win32_time.h"
 
 #define assert_hr(hr) assert(SUCCEEDED(hr))
 
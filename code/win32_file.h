@@ -21,6 +21,24 @@ print(char* format, ...) {
     OutputDebugStringA(buffer);
 }
 
+// NOTE: Raw write to stdout, bypasses stdio. Anything print() still has buffered goes out first so the two
+// don't interleave out of order. Unlike print() this doesn't mirror to OutputDebugStringA, it's for bulk output.
+static void
+os_write_stdout(void* data, u64 size){
+    fflush(stdout);
+    HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
+    u8* ptr = (u8*)data;
+    while(size > 0){
+        DWORD chunk = (DWORD)MIN(size, (u64)GB(1));
+        DWORD written = 0;
+        if(!WriteFile(handle, ptr, chunk, &written, 0)){
+            return;
+        }
+        ptr += written;
+        size -= written;
+    }
+}
+
 // TODO: This probably needs to be part if an IO file, maybe win32_file? idk.
 static String8
 read_stdin(Arena* arena){
@@ -175,6 +193,115 @@ os_file_write(FileData data, String8 dir, String8 file_name, u64 offset){
     return(result);
 }
 
+///////////////////////////////
+// NOTE: Win32 Open Files
+///////////////////////////////
+// NOTE: For files that stay open and are accessed by offset through an IOQueue (win32_io.h).
+// The handle is opened for overlapped I/O, so it can't be used with os_file_read/os_file_write.
+
+typedef struct OSFile{
+    u64 handle;
+} OSFile;
+
+typedef enum OSFileFlag{
+    OSFileFlag_direct = (1 << 0), // NOTE: bypass the OS page cache. Buffers, offsets and sizes must be multiples of os_file_block_size()
+    OSFileFlag_sequential = (1 << 1), // NOTE: read only and must already exist, read front to back with os_file_read_next()
+    OSFileFlag_quiet = (1 << 2), // NOTE: a failed open prints nothing, for callers that try another way next
+} OSFileFlag;
+
+static OSFile
+os_file_open(String8 dir, String8 file_name, u32 flags){
+    OSFile result = ZERO_INIT;
+    ScratchArena scratch = begin_scratch(0);
+    String8 full_path = str8_concatenate(scratch.arena, dir, file_name);
+    String16 wide_path = os_utf8_utf16(scratch.arena, full_path);
+
+    DWORD access = GENERIC_READ|GENERIC_WRITE;
+    DWORD disposition = OPEN_ALWAYS;
+    DWORD attributes = FILE_FLAG_OVERLAPPED;
+    if(flags & OSFileFlag_sequential){
+        // NOTE: Synchronous handle, ReadFile advances the file pointer like read() does.
+        access = GENERIC_READ;
+        disposition = OPEN_EXISTING;
+        attributes = FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+    if(flags & OSFileFlag_direct){
+        attributes |= FILE_FLAG_NO_BUFFERING;
+    }
+    HANDLE file_handle = CreateFileW((wchar*)wide_path.str, access, FILE_SHARE_READ, 0, disposition, attributes, 0);
+    end_scratch(scratch);
+    if(file_handle == INVALID_HANDLE_VALUE){
+        DWORD err = GetLastError();
+        if(!(flags & OSFileFlag_quiet)){
+            print("os_file_open: failed to create file handle - error: %d\n", err);
+        }
+        return(result);
+    }
+
+    result.handle = (u64)file_handle;
+    return(result);
+}
+
+static bool
+os_file_is_valid(OSFile file){
+    return(file.handle != 0);
+}
+
+// NOTE: stdin as an OSFile, for os_file_read_next(). Don't os_file_close() it.
+static OSFile
+os_file_stdin(void){
+    OSFile result = {(u64)GetStdHandle(STD_INPUT_HANDLE)};
+    return(result);
+}
+
+static bool
+os_file_is_interactive(OSFile file){
+    return(GetFileType((HANDLE)file.handle) == FILE_TYPE_CHAR);
+}
+
+// NOTE: Reads from the current position and advances it. Returns bytes read, 0 at end of file, < 0 on failure.
+// Short reads are normal for pipes and the console. Only for handles opened without FILE_FLAG_OVERLAPPED.
+static s64
+os_file_read_next(OSFile file, void* buffer, u64 size){
+    DWORD bytes_read = 0;
+    DWORD chunk = (DWORD)MIN(size, (u64)GB(1));
+    if(!ReadFile((HANDLE)file.handle, buffer, chunk, &bytes_read, 0)){
+        // NOTE: The writing end of a pipe closing is the pipe's end of file.
+        if(GetLastError() == ERROR_BROKEN_PIPE){
+            return(0);
+        }
+        return(-1);
+    }
+    return((s64)bytes_read);
+}
+
+static u64
+os_file_size(OSFile file){
+    u64 result = 0;
+    LARGE_INTEGER LARGE_file_size;
+    if(GetFileSizeEx((HANDLE)file.handle, &LARGE_file_size)){
+        result = (u64)LARGE_file_size.QuadPart;
+    }
+    return(result);
+}
+
+static u32
+os_file_block_size(OSFile file){
+    u32 result = 0;
+    FILE_STORAGE_INFO storage_info;
+    if(GetFileInformationByHandleEx((HANDLE)file.handle, FileStorageInfo, &storage_info, sizeof(storage_info))){
+        result = (u32)storage_info.PhysicalBytesPerSectorForPerformance;
+    }
+    return(result);
+}
+
+static void
+os_file_close(OSFile file){
+    if(os_file_is_valid(file)){
+        CloseHandle((HANDLE)file.handle);
+    }
+}
+
 ///////////////////////////////
 // NOTE: Win32 File Operations
 ///////////////////////////////
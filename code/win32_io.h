@@ -0,0 +1,140 @@
+#if !defined(WIN32_IO_H)
+#define WIN32_IO_H
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "base_types.h"
+#include "base_memory.h"
+#include "win32_file.h"
+
+///////////////////////////////
+// NOTE: Win32 Async I/O
+///////////////////////////////
+// NOTE: Positional reads/writes against an OSFile, completions come back through an I/O completion port.
+// Same interface as linux_io.h. Overlapped ReadFile/WriteFile are already in flight when they return,
+// so os_io_flush() has nothing to batch here.
+//
+// usage:
+//     os_io_submit(io, IOOp_read, buffer, size, offset, tag); // returns false when the queue is full, poll first
+//     os_io_flush(io);
+//     u32 count = os_io_poll(io, completions, array_count(completions), true);
+
+typedef enum IOOp{
+    IOOp_read,
+    IOOp_write,
+} IOOp;
+
+typedef struct IOCompletion{
+    IOOp op;
+    u64 tag;
+    s64 result; // NOTE: bytes transferred, or < 0 on failure
+} IOCompletion;
+
+typedef struct IOSlot{
+    OVERLAPPED overlapped;
+    IOOp op;
+    u64 tag;
+    struct IOSlot* next;
+} IOSlot;
+
+typedef struct IOQueue{
+    OSFile file;
+    HANDLE port;
+    u32 depth;
+    u32 in_flight; // NOTE: submitted and not yet returned by os_io_poll()
+    IOSlot* slots;
+    IOSlot* free_slots;
+} IOQueue;
+
+static IOQueue*
+os_io_create(Arena* arena, OSFile file, u32 depth){
+    IOQueue* io = push_struct(arena, IOQueue);
+    io->file = file;
+    io->depth = depth;
+    io->in_flight = 0;
+    io->port = CreateIoCompletionPort((HANDLE)file.handle, 0, 0, 1);
+    if(io->port == 0){
+        DWORD err = GetLastError();
+        print("os_io_create: failed to create completion port - error: %d\n", err);
+        exit(EXIT_FAILURE);
+    }
+
+    io->slots = push_array(arena, IOSlot, depth);
+    io->free_slots = 0;
+    for(u32 i=0; i < depth; ++i){
+        io->slots[i].next = io->free_slots;
+        io->free_slots = io->slots + i;
+    }
+    return(io);
+}
+
+static void
+os_io_destroy(IOQueue* io){
+    CloseHandle(io->port);
+}
+
+static bool
+os_io_submit(IOQueue* io, IOOp op, void* buffer, u64 size, u64 offset, u64 tag){
+    if(io->in_flight >= io->depth){
+        return(false);
+    }
+    IOSlot* slot = io->free_slots;
+    io->free_slots = slot->next;
+    io->in_flight += 1;
+
+    mem_set(&slot->overlapped, 0, sizeof(slot->overlapped));
+    slot->overlapped.Offset = (DWORD)(offset & 0x00000000FFFFFFFF);
+    slot->overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    slot->op = op;
+    slot->tag = tag;
+
+    BOOL ok;
+    if(op == IOOp_read){
+        ok = ReadFile((HANDLE)io->file.handle, buffer, (DWORD)size, 0, &slot->overlapped);
+    }
+    else{
+        ok = WriteFile((HANDLE)io->file.handle, buffer, (DWORD)size, 0, &slot->overlapped);
+    }
+    if(!ok && GetLastError() != ERROR_IO_PENDING){
+        // NOTE: Failed before it was queued, hand the failure back through the port like any other completion.
+        slot->overlapped.Internal = (ULONG_PTR)-1;
+        PostQueuedCompletionStatus(io->port, 0, 0, &slot->overlapped);
+    }
+    return(true);
+}
+
+static void
+os_io_flush(IOQueue* io){
+}
+
+static u32
+os_io_poll(IOQueue* io, IOCompletion* completions, u32 max_count, bool wait){
+    u32 count = 0;
+    if(io->in_flight == 0){
+        return(count);
+    }
+
+    OVERLAPPED_ENTRY entries[64];
+    ULONG removed = 0;
+    ULONG max_entries = (ULONG)MIN(max_count, array_count(entries));
+    if(!GetQueuedCompletionStatusEx(io->port, entries, max_entries, &removed, wait ? INFINITE : 0, FALSE)){
+        return(count);
+    }
+
+    for(ULONG i=0; i < removed; ++i){
+        IOSlot* slot = CONTAINING_RECORD(entries[i].lpOverlapped, IOSlot, overlapped);
+        IOCompletion* completion = completions + count++;
+        completion->op = slot->op;
+        completion->tag = slot->tag;
+        // NOTE: Internal holds the NTSTATUS of the request, 0 is success.
+        completion->result = (slot->overlapped.Internal == 0) ? (s64)entries[i].dwNumberOfBytesTransferred : -1;
+
+        slot->next = io->free_slots;
+        io->free_slots = slot;
+    }
+
+    io->in_flight -= count;
+    return(count);
+}
+
+#endif
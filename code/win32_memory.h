@@ -17,7 +17,8 @@ static void* os_virtual_alloc(u64 size){
     return(result);
 }
 
-static bool os_virtual_free(void* base){
+static bool os_virtual_free(void* base, u64 size){
+    // NOTE: size is only needed by the posix side (munmap), MEM_RELEASE always frees the whole reservation.
     bool result = false;
     if(base){
         result = VirtualFree(base, 0, MEM_RELEASE);
@@ -25,12 +26,37 @@ static bool os_virtual_free(void* base){
     return(result);
 }
 
+static void* os_reserve(u64 size){
+    void* result = VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+    return(result);
+}
+
+static bool os_commit(void* base, u64 size){
+    // NOTE: Committed pages are zero filled on first touch.
+    bool result = (VirtualAlloc(base, size, MEM_COMMIT, PAGE_READWRITE) != 0);
+    return(result);
+}
+
+static void os_decommit(void* base, u64 size){
+    VirtualFree(base, size, MEM_DECOMMIT);
+}
+
+static void os_release(void* base, u64 size){
+    // NOTE: size is only needed by the posix side (munmap), MEM_RELEASE always frees the whole reservation.
+    VirtualFree(base, 0, MEM_RELEASE);
+}
+
+static bool os_advise_huge_pages(void* base, u64 size){
+    // NOTE: Windows has no transparent huge pages. Large pages have to be asked for up front with
+    // MEM_LARGE_PAGES and need SeLockMemoryPrivilege, so this stays a no-op and the pool uses normal pages.
+    return(false);
+}
+
 static Arena* os_alloc_arena(size_t size){
+    // NOTE: Fully committed up front, grows by chaining more virtual blocks like any other arena.
     void* memory = os_virtual_alloc((size + sizeof(Arena)));
     Arena* result = (Arena*)memory;
-    result->base = (u8*)memory + sizeof(Arena);
-    result->size = size;
-    result->used = 0;
+    arena_init_block(result, (u8*)memory + sizeof(Arena), size, size, ArenaFlag_virtual);
     return(result);
 }
 
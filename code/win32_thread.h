@@ -0,0 +1,115 @@
+#if !defined(WIN32_THREAD_H)
+#define WIN32_THREAD_H
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "base_types.h"
+
+///////////////////////////////
+// NOTE: Win32 Threads
+///////////////////////////////
+// NOTE: Threads, mutexes and condition variables. Same interface as linux_thread.h, the mutex is an SRW lock
+// held exclusively.
+//
+// usage:
+//     OSThread thread;
+//     os_thread_start(&thread, proc, data); // thread must stay put until os_thread_join()
+//     os_thread_join(&thread);
+
+typedef void OSThreadProc(void* data);
+
+typedef struct OSThread{
+    HANDLE handle;
+    OSThreadProc* proc;
+    void* data;
+} OSThread;
+
+typedef struct OSMutex{
+    SRWLOCK handle;
+} OSMutex;
+
+typedef struct OSCondition{
+    CONDITION_VARIABLE handle;
+} OSCondition;
+
+static DWORD WINAPI
+os_thread_entry(void* data){
+    OSThread* thread = (OSThread*)data;
+    thread->proc(thread->data);
+    return(0);
+}
+
+static bool
+os_thread_start(OSThread* thread, OSThreadProc* proc, void* data){
+    thread->proc = proc;
+    thread->data = data;
+    thread->handle = CreateThread(0, 0, os_thread_entry, thread, 0, 0);
+    return(thread->handle != 0);
+}
+
+static void
+os_thread_join(OSThread* thread){
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+static void
+os_mutex_init(OSMutex* mutex){
+    InitializeSRWLock(&mutex->handle);
+}
+
+static void
+os_mutex_lock(OSMutex* mutex){
+    AcquireSRWLockExclusive(&mutex->handle);
+}
+
+static void
+os_mutex_unlock(OSMutex* mutex){
+    ReleaseSRWLockExclusive(&mutex->handle);
+}
+
+static void
+os_condition_init(OSCondition* condition){
+    InitializeConditionVariable(&condition->handle);
+}
+
+static void
+os_condition_wait(OSCondition* condition, OSMutex* mutex){
+    SleepConditionVariableSRW(&condition->handle, &mutex->handle, INFINITE, 0);
+}
+
+static void
+os_condition_signal(OSCondition* condition){
+    WakeConditionVariable(&condition->handle);
+}
+
+static void
+os_condition_broadcast(OSCondition* condition){
+    WakeAllConditionVariable(&condition->handle);
+}
+
+///////////////////////////////
+// NOTE: Win32 Interrupt
+///////////////////////////////
+// NOTE: ctrl-c and ctrl-break call handler instead of killing the process. The console handler runs on its own
+// thread, handler should only set flags.
+
+typedef void OSInterruptFunc(void);
+global OSInterruptFunc* os_interrupt_func;
+
+static BOOL WINAPI
+os_interrupt_console(DWORD type){
+    if(type == CTRL_C_EVENT || type == CTRL_BREAK_EVENT){
+        os_interrupt_func();
+        return(TRUE);
+    }
+    return(FALSE);
+}
+
+static void
+os_set_interrupt_handler(OSInterruptFunc* handler){
+    os_interrupt_func = handler;
+    SetConsoleCtrlHandler(os_interrupt_console, TRUE);
+}
+
+#endif
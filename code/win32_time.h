@@ -0,0 +1,28 @@
+#if !defined(WIN32_TIME_H)
+#define WIN32_TIME_H
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "base_types.h"
+
+///////////////////////////////
+// NOTE: Win32 Clock
+///////////////////////////////
+// NOTE: Same interface as linux_time.h, on top of QueryPerformanceCounter.
+
+static u64
+os_time_ns(void){
+    local u64 frequency = 0;
+    if(frequency == 0){
+        LARGE_INTEGER LARGE_frequency;
+        QueryPerformanceFrequency(&LARGE_frequency);
+        frequency = (u64)LARGE_frequency.QuadPart;
+    }
+    LARGE_INTEGER LARGE_now;
+    QueryPerformanceCounter(&LARGE_now);
+    u64 now = (u64)LARGE_now.QuadPart;
+    // NOTE: Split so the multiply doesn't overflow for long uptimes.
+    return((now / frequency) * 1000000000ull + ((now % frequency) * 1000000000ull) / frequency);
+}
+
+#endif
@@ -0,0 +1,24 @@
+# NOTE: Values are bound into prepared statements, in a script through the plan cache lifting them out of the
+# text. A bound value is validated like a literal, a shorter value replaces a longer one completely, and a ?
+# left in the text stays unbound.
+cat <<'SCRIPT'
+insert 1 longername longer@example.com
+insert 2 al al@x
+select where username = al
+select where username = longername
+select where username = longernam
+select username where username like long%
+select where id = 99999999999
+select where id = -1
+insert 3 bob bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb@x
+insert 3 bob b@x
+select where id >= 2 limit 1
+select where id >= 2 limit 0
+select where id >= 2 limit 99999999999999999999
+select where id >= 2 limit ?
+insert 4 ? d@x
+select where id = ?
+explain analyze select where id = ?
+insert 4 d d@x
+select id where email = d@x
+SCRIPT
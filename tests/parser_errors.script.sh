@@ -0,0 +1,29 @@
+# NOTE: Statements the parser accepts and the ones it rejects, with the error each one gets. Errors don't stop a
+# script, the exit code says one of its statements failed.
+cat <<'SCRIPT'
+insert 1 alice alice@example.com
+insert 4294967295 max max@example.com
+insert 3 aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa c@example.com
+insert 3 aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa c@example.com
+insert -5 neg neg@example.com
+insert 4294967296 big big@example.com
+insert x bob bob@example.com
+insert 2 bob
+insert 1 dup dup@example.com
+update 1
+select
+select *
+select email, id
+select id username
+select nope
+select where id = 1 extra
+select where
+select where id>=1
+select where id like a%
+select where id >= 1 and username = alice
+select where id >= 1 and id <= 5 and email != x
+select where username like a%
+select where email like %example.com limit 1
+select limit
+select limit x
+SCRIPT
@@ -0,0 +1,30 @@
+# NOTE: Every script statement goes through the plan cache, so these check what a cached plan must not keep from
+# its last use: the values lifted out of the text, bindings a ? in the text should have left unbound, and after
+# more than PLAN_CACHE_SIZE (64) shapes, the statement of a recycled slot.
+echo "insert 1 alice alice@example.com"
+echo "insert 2 bob bob@example.com"
+echo "select where id = 1"
+echo "select where id = 2"
+echo "select where id = ?"
+echo "insert -3 carol carol@example.com"
+echo "insert 3 carol carol@example.com"
+printf "select \t where  id   >= 2\tlimit 1\n"
+echo "select where id >= 2 limit 5"
+echo "select where username = limit limit 1"
+echo "select where username = where"
+echo "insert 4 limit where"
+echo "select where username = limit limit 1"
+echo "select where email = where and id > 3"
+
+# NOTE: 90 shapes, the first ones are long gone from the cache when they run again below.
+for columns in "" "id" "username" "email" "id username" "id email" "username email" "id username email" "*"; do
+    for where in "" "where id >= 4" "where id < 2" "where username != alice" "where email like c%"; do
+        echo "select $columns $where"
+        echo "select $columns $where limit 1"
+    done
+done
+echo "select where id = 3"
+echo "select where id = ?"
+echo "insert 5 dave dave@example.com"
+echo "select id where id >= 4"
+echo "select"
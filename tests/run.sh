@@ -0,0 +1,92 @@
+#!/bin/bash
+# NOTE: Script regression tests. Each test runs `db --script` in an empty directory, so against a fresh
+# data/mydb.db, and compares everything it prints plus its exit code with <test>.expected.
+#
+# A test is either <test>.script, fed to db as is, or <test>.script.sh, which writes the script to stdout (for
+# inputs that are too big or too repetitive to keep in the tree).
+#
+# A <test>.wire test runs `db --server` instead and feeds the file to the db_client built next to db, see
+# db_client.cpp for its request lines, and <test>.wire.sh writes them to stdout. The output is the client's, its
+# exit code, and the server's exit code after an interrupt.
+#
+# usage:
+#     tests/run.sh path/to/db              run every test
+#     tests/run.sh path/to/db long_line    only the tests whose name contains long_line
+#     UPDATE=1 tests/run.sh path/to/db     rewrite the .expected files from the current output
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 path/to/db [filter]"
+    exit 2
+fi
+db=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+filter=$2
+tests_dir=$(cd "$(dirname "$0")" && pwd)
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+client=$(dirname "$db")/db_client
+
+pass=0
+fail=0
+for test_path in "$tests_dir"/*.script "$tests_dir"/*.script.sh "$tests_dir"/*.wire "$tests_dir"/*.wire.sh; do
+    [ -e "$test_path" ] || continue
+    name=$(basename "$test_path")
+    name=${name%.sh}
+    name=${name%.script}
+    name=${name%.wire}
+    if [ -n "$filter" ] && [[ "$name" != *"$filter"* ]]; then
+        continue
+    fi
+
+    rm -rf "$work_dir/run" && mkdir "$work_dir/run"
+    if [[ "$test_path" == *.wire || "$test_path" == *.wire.sh ]]; then
+        if [ ! -x "$client" ]; then
+            echo "FAIL $name, needs db_client next to db"
+            fail=$((fail + 1))
+            continue
+        fi
+        if [[ "$test_path" == *.sh ]]; then
+            bash "$test_path" > "$work_dir/run/input.wire"
+        else
+            cp "$test_path" "$work_dir/run/input.wire"
+        fi
+        (
+            cd "$work_dir/run"
+            "$db" --server db.sock > server_output 2>&1 &
+            server=$!
+            for i in $(seq 50); do
+                [ -S db.sock ] && break
+                sleep 0.1
+            done
+            "$client" db.sock < input.wire > output 2>&1
+            echo "exit $?" >> output
+            kill -INT $server
+            wait $server
+            echo "server exit $?" >> output
+        )
+    else
+        if [[ "$test_path" == *.sh ]]; then
+            bash "$test_path" > "$work_dir/run/input.script"
+        else
+            cp "$test_path" "$work_dir/run/input.script"
+        fi
+        (cd "$work_dir/run" && "$db" --script input.script > output 2>&1; echo "exit $?" >> output)
+    fi
+
+    expected="$tests_dir/$name.expected"
+    if [ -n "$UPDATE" ]; then
+        cp "$work_dir/run/output" "$expected"
+        echo "updated $name"
+    elif diff -u "$expected" "$work_dir/run/output" > "$work_dir/diff" 2>&1; then
+        pass=$((pass + 1))
+    else
+        echo "FAIL $name"
+        head -n 40 "$work_dir/diff" | cut -c 1-200
+        fail=$((fail + 1))
+    fi
+done
+
+if [ -z "$UPDATE" ]; then
+    echo "$pass passed, $fail failed"
+fi
+[ $fail -eq 0 ]
@@ -0,0 +1,11 @@
+# NOTE: Lines longer than the 1MB script buffer are reported and skipped up to their newline, the lines after
+# them still run and keep their line numbers. One long line spans several buffer fills, the last one has no newline.
+echo "insert 1 alice alice@example.com"
+head -c $((1024 * 1024 + 10)) /dev/zero | tr '\0' 'x'
+echo
+echo "insert 2 bob bob@example.com"
+echo "foo"
+head -c $((3 * 1024 * 1024 + 5)) /dev/zero | tr '\0' 'y'
+echo
+echo "select"
+head -c $((1024 * 1024 + 1)) /dev/zero | tr '\0' 'z'
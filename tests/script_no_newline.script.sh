@@ -0,0 +1,2 @@
+# NOTE: The last line of a script doesn't need a newline.
+printf 'insert 1 alice alice@example.com\nselect'
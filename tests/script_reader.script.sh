@@ -0,0 +1,15 @@
+# NOTE: How the script reader splits its input into statements: CRLF line endings, blank and whitespace only
+# lines (skipped, they keep their line numbers), meta commands between statements, and .exit ending the script
+# before the lines after it, with an exit code that still counts the errors before it. .exit prints "quiting"
+# without a newline.
+printf 'insert 1 alice alice@example.com\r\n'
+printf '\n\n'
+printf 'insert 2 bob bob@example.com\n'
+printf '   \n\t\n'
+printf 'foo\n'
+printf '.mode csv\n'
+printf 'select\n'
+printf '.mode text\n'
+printf 'select where id = 2\r\n'
+printf '.exit\n'
+printf 'select\n'
@@ -0,0 +1,10 @@
+# NOTE: A result bigger than the server's 64KB result buffer goes out as several rows frames, rows split across
+# them. 300 rows of about 300 bytes each, read back through a prepared select and a one off query.
+echo "prepare insert ? ? ?"
+email=$(head -c 250 /dev/zero | tr '\0' 'e')
+for i in $(seq 300); do
+    echo "execute 0 u32 $i text user$i text $email@$i"
+done
+echo "prepare select id email where id > ?"
+echo "execute 1 u32 0"
+echo "query select id where id >= 290"